@@ -0,0 +1,199 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GAZEBO_VIGIR_ASYNC_LOG_HH
+#define GAZEBO_VIGIR_ASYNC_LOG_HH
+
+#include <stdint.h>
+
+#include <boost/atomic.hpp>
+#include <boost/lockfree/queue.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/// \brief Logging for the plugin update paths.
+///
+/// VIGIR_LOG_<LEVEL>(format, args...) takes the same printf style format
+/// as ROS_<LEVEL>, so it can replace it directly.  The message is formatted
+/// into a fixed size record on the calling thread and pushed into a fixed
+/// size lock-free queue, a background thread hands it to rosconsole.  The
+/// calling thread never allocates and doesn't wait for the output.
+/// Messages are truncated to fit the record.
+///
+/// Every call site keeps its own state: a message identical to the last one
+/// from the same site is dropped for one second, and
+/// VIGIR_LOG_<LEVEL>_THROTTLE(interval, format, args...) drops everything
+/// from the site for interval seconds.  The next message that gets through
+/// reports how many were dropped.
+#define VIGIR_LOG_IMPL(level, interval, throttle, ...) \
+  do \
+  { \
+    static gazebo::LogSite vigir_log_site(level, interval, throttle, \
+                                          __FILE__, __LINE__); \
+    gazebo::AsyncLog::Write(vigir_log_site, __VA_ARGS__); \
+  } while (0)
+
+#define VIGIR_LOG_DEBUG(...) \
+  VIGIR_LOG_IMPL(gazebo::LL_DEBUG, 1.0, false, __VA_ARGS__)
+#define VIGIR_LOG_INFO(...) \
+  VIGIR_LOG_IMPL(gazebo::LL_INFO, 1.0, false, __VA_ARGS__)
+#define VIGIR_LOG_WARN(...) \
+  VIGIR_LOG_IMPL(gazebo::LL_WARN, 1.0, false, __VA_ARGS__)
+#define VIGIR_LOG_ERROR(...) \
+  VIGIR_LOG_IMPL(gazebo::LL_ERROR, 1.0, false, __VA_ARGS__)
+
+#define VIGIR_LOG_DEBUG_THROTTLE(interval, ...) \
+  VIGIR_LOG_IMPL(gazebo::LL_DEBUG, interval, true, __VA_ARGS__)
+#define VIGIR_LOG_INFO_THROTTLE(interval, ...) \
+  VIGIR_LOG_IMPL(gazebo::LL_INFO, interval, true, __VA_ARGS__)
+#define VIGIR_LOG_WARN_THROTTLE(interval, ...) \
+  VIGIR_LOG_IMPL(gazebo::LL_WARN, interval, true, __VA_ARGS__)
+#define VIGIR_LOG_ERROR_THROTTLE(interval, ...) \
+  VIGIR_LOG_IMPL(gazebo::LL_ERROR, interval, true, __VA_ARGS__)
+
+namespace gazebo
+{
+  /// \brief Log levels, mapped to the rosconsole levels.
+  enum LogLevel
+  {
+    LL_DEBUG = 0,
+    LL_INFO,
+    LL_WARN,
+    LL_ERROR
+  };
+
+  /// \brief State of one VIGIR_LOG_* call site.
+  class LogSite
+  {
+    /// \brief Constructor.
+    /// \param[in] _level Log level.
+    /// \param[in] _interval Suppression interval in seconds.
+    /// \param[in] _throttle Suppress every message for _interval instead of
+    /// identical ones only.
+    /// \param[in] _file Source file.
+    /// \param[in] _line Source line.
+    public: LogSite(LogLevel _level, double _interval, bool _throttle,
+                    const char *_file, int _line);
+
+    /// \brief Decide if a message passes the rate limit.
+    /// \param[in] _hash Hash of the message arguments.
+    /// \param[out] _suppressed Messages dropped since the last one that
+    /// passed.
+    /// \return true if the message should be logged.
+    public: bool Allow(uint64_t _hash, uint32_t &_suppressed);
+
+    /// \brief Log level.
+    public: const LogLevel level;
+
+    /// \brief Source file.
+    public: const char *const file;
+
+    /// \brief Source line.
+    public: const int line;
+
+    /// \brief Suppression interval in nanoseconds.
+    private: const int64_t interval;
+
+    /// \brief Suppress all messages, not just identical ones.
+    private: const bool throttle;
+
+    /// \brief Monotonic time the suppression ends, in nanoseconds.
+    private: boost::atomic<int64_t> quietUntil;
+
+    /// \brief Hash of the last message that passed.
+    private: boost::atomic<uint64_t> lastHash;
+
+    /// \brief Messages dropped since the last one that passed.
+    private: boost::atomic<uint32_t> suppressed;
+  };
+
+  /// \brief A queued log message.  Plain old data, so it can live in a
+  /// lock-free queue.
+  struct LogRecord
+  {
+    /// \brief Size of the message buffer.
+    static const unsigned int TextSize = 256;
+
+    /// \brief Call site.
+    LogSite *site;
+
+    /// \brief Messages dropped at this site before this one.
+    uint32_t suppressed;
+
+    /// \brief Formatted message, always null terminated.
+    char text[TextSize];
+  };
+
+  /// \brief Background log writer, see VIGIR_LOG_INFO.
+  class AsyncLog
+  {
+    /// \brief Get the process-wide log.  Plugins call this from Load, so
+    /// the queue and thread exist before the first update.
+    /// \return The log.
+    public: static AsyncLog &Instance();
+
+    /// \brief Destructor, writes the queued messages and stops the thread.
+    public: ~AsyncLog();
+
+    /// \brief Format and queue a message.
+    /// \param[in] _site Call site.
+    /// \param[in] _format printf style format.
+    public: static void Write(LogSite &_site, const char *_format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+    /// \brief Number of records the queue holds.
+    private: static const unsigned int Capacity = 1024;
+
+    /// \brief Constructor, starts the writer thread.
+    private: AsyncLog();
+
+    /// \brief Queue a record and wake the writer thread if it sleeps.
+    /// \param[in] _record The record.
+    private: void Push(const LogRecord &_record);
+
+    /// \brief Writer thread.
+    private: void Run();
+
+    /// \brief Write one record.
+    /// \param[in] _record The record.
+    private: void Output(const LogRecord &_record);
+
+    /// \brief Queued records.
+    private: boost::lockfree::queue<LogRecord,
+             boost::lockfree::fixed_sized<true> > queue;
+
+    /// \brief Records dropped because the queue was full.
+    private: boost::atomic<uint32_t> dropped;
+
+    /// \brief Cleared to stop the writer thread.
+    private: boost::atomic<bool> running;
+
+    /// \brief Set while the writer thread waits for records, only then
+    /// does Push() take the mutex to wake it.
+    private: boost::atomic<bool> sleeping;
+
+    /// \brief Protects the wait on wakeCondition.
+    private: boost::mutex wakeMutex;
+
+    /// \brief Signaled on new records and on shutdown.
+    private: boost::condition_variable wakeCondition;
+
+    /// \brief Writer thread.
+    private: boost::thread thread;
+  };
+}
+#endif
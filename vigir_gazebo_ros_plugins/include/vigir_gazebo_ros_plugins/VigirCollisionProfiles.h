@@ -0,0 +1,162 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GAZEBO_VIGIR_COLLISION_PROFILES_HH
+#define GAZEBO_VIGIR_COLLISION_PROFILES_HH
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gazebo/physics/physics.hh>
+
+namespace gazebo
+{
+  /// \brief Named sets of collision category and collide bits for the
+  /// collisions of a few models.  The collisions are cached and every
+  /// profile is computed once when it is defined, switching profiles then
+  /// only writes the bits that differ from the active profile.
+  ///
+  /// Usage: AddModel() the models, Define() the profiles and set their
+  /// bits, then Apply() them by id.
+  class CollisionProfiles
+  {
+    /// \brief Profile id, an index.
+    public: typedef int Id;
+
+    /// \brief Id of no profile.
+    public: static const Id NoProfile = -1;
+
+    /// \brief Collide with everything, the "all" collide mode.
+    public: static const unsigned int AllBits = 0x0FFFFFFF;
+
+    /// \brief Category of the "fixed" collide mode.
+    public: static const unsigned int FixedBit = 0x00000001;
+
+    /// \brief Constructor.
+    public: CollisionProfiles();
+
+    /// \brief Forget all models and profiles.
+    public: void Clear();
+
+    /// \brief Cache the collisions of a model.  Their current bits become
+    /// the starting point of profiles defined afterwards.
+    /// \param[in] _model the model.
+    public: void AddModel(const physics::ModelPtr &_model);
+
+    /// \brief Define a profile, or reset it if it exists already.
+    /// \param[in] _name profile name.
+    /// \return its id.
+    public: Id Define(const std::string &_name);
+
+    /// \brief Look up a profile.
+    /// \param[in] _name profile name.
+    /// \return its id, NoProfile if there is none.
+    public: Id Find(const std::string &_name) const;
+
+    /// \brief Name of a profile.
+    /// \param[in] _id profile id.
+    /// \return its name, empty for NoProfile.
+    public: std::string Name(Id _id) const;
+
+    /// \brief Set the bits of a link's collisions in a profile.
+    /// \param[in] _id profile id.
+    /// \param[in] _link the link, must belong to an added model.
+    /// \param[in] _category category bits.
+    /// \param[in] _collide collide bits.
+    public: void SetLink(Id _id, const physics::LinkPtr &_link,
+                         unsigned int _category, unsigned int _collide);
+
+    /// \brief Set the category of all collisions of a model in a profile
+    /// and clear bits from their collide bits.
+    /// \param[in] _id profile id.
+    /// \param[in] _model the model, must have been added.
+    /// \param[in] _category category bits.
+    /// \param[in] _ignore collide bits to clear.
+    public: void SetModel(Id _id, const physics::ModelPtr &_model,
+                          unsigned int _category, unsigned int _ignore);
+
+    /// \brief Switch to a profile.
+    /// \param[in] _id profile id.
+    public: void Apply(Id _id);
+
+    /// \brief Active profile.
+    /// \return its id, NoProfile before the first Apply().
+    public: Id Active() const;
+
+    /// \brief Override the bits of a link's collisions outside of the
+    /// profiles, until RestoreLink() or an Apply() that changes them.
+    /// \param[in] _link the link.
+    /// \param[in] _category category bits.
+    /// \param[in] _collide collide bits.
+    public: void OverrideLink(const physics::LinkPtr &_link,
+                              unsigned int _category, unsigned int _collide);
+
+    /// \brief Put the bits of a link's collisions back to the active
+    /// profile.
+    /// \param[in] _link the link.
+    public: void RestoreLink(const physics::LinkPtr &_link);
+
+    /// \brief Collision bits.
+    private: struct Bits
+    {
+      /// \brief Category bits.
+      unsigned int category;
+
+      /// \brief Collide bits.
+      unsigned int collide;
+    };
+
+    /// \brief Write bits to a collision if they changed.
+    /// \param[in] _index collision index.
+    /// \param[in] _bits new bits.
+    private: void Write(size_t _index, const Bits &_bits);
+
+    /// \brief Range of collisions of a link.
+    /// \param[in] _link the link.
+    /// \param[out] _begin first collision index.
+    /// \param[out] _end one past the last collision index.
+    /// \return false if the link wasn't added.
+    private: bool LinkRange(const physics::LinkPtr &_link,
+                            size_t &_begin, size_t &_end) const;
+
+    /// \brief Cached collisions.
+    private: physics::Collision_V collisions;
+
+    /// \brief Bits last written to each collision.
+    private: std::vector<Bits> current;
+
+    /// \brief Bits of each collision when its model was added.
+    private: std::vector<Bits> initial;
+
+    /// \brief Collision index range of each link.
+    private: std::map<physics::Link *, std::pair<size_t, size_t> > links;
+
+    /// \brief Collision index range of each model.
+    private: std::map<physics::Model *, std::pair<size_t, size_t> > models;
+
+    /// \brief Profile names, by id.
+    private: std::vector<std::string> names;
+
+    /// \brief Profile bits, by id and collision index.
+    private: std::vector<std::vector<Bits> > profiles;
+
+    /// \brief Active profile.
+    private: Id active;
+  };
+}
+#endif
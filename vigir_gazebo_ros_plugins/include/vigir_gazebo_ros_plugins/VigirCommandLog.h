@@ -0,0 +1,189 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GAZEBO_VIGIR_COMMAND_LOG_HH
+#define GAZEBO_VIGIR_COMMAND_LOG_HH
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <ros/serialization.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <gazebo/common/Time.hh>
+#include <gazebo/physics/physics.hh>
+
+namespace gazebo
+{
+  /// \brief Plugins that write into a command log.  Several plugins may
+  /// share one log file, each record is tagged with its source.
+  enum CommandSource
+  {
+    CS_VRC = 0,
+    CS_LEFT_HAND = 1,
+    CS_RIGHT_HAND = 2
+  };
+
+  /// \brief One command read back from a command log.
+  struct CommandRecord
+  {
+    /// \brief World iteration count when the command was applied.
+    uint64_t tick;
+
+    /// \brief Sim time when the command was applied.
+    common::Time time;
+
+    /// \brief Plugin that recorded the command, see CommandSource.
+    uint8_t source;
+
+    /// \brief Plugin specific command type.
+    uint8_t type;
+
+    /// \brief ROS serialized command message.
+    std::vector<uint8_t> payload;
+  };
+
+  /// \brief Binary log of the incoming plugin commands of one session.
+  ///
+  /// The file starts with an 8 byte magic, followed by records of
+  ///   uint64 tick, int32 sec, int32 nsec, uint8 source, uint8 type,
+  ///   uint32 length, length bytes of ROS serialized message
+  /// in host byte order, in increasing tick order.  Records are buffered
+  /// and written out in large blocks, the file is flushed when the writer
+  /// is closed.  A crashed run loses the buffered tail, the reader skips
+  /// a truncated last record.
+  class CommandLogWriter
+  {
+    /// \brief Open a log, replacing an existing file.  Plugins in the same
+    /// process asking for the same path share one writer.
+    /// \param[in] _path Log file name.
+    /// \return The writer, or NULL if the file can't be opened.
+    public: static boost::shared_ptr<CommandLogWriter> Open(
+      const std::string &_path);
+
+    /// \brief Destructor, flushes and closes the file.
+    public: ~CommandLogWriter();
+
+    /// \brief Append one command.
+    /// \param[in] _tick World iteration count.
+    /// \param[in] _time Sim time.
+    /// \param[in] _source Plugin writing the record.
+    /// \param[in] _type Plugin specific command type.
+    /// \param[in] _msg The command.
+    public: template<class M>
+            void Write(uint64_t _tick, const common::Time &_time,
+                       uint8_t _source, uint8_t _type, const M &_msg)
+    {
+      boost::mutex::scoped_lock lock(this->mutex);
+      uint32_t length = ros::serialization::serializationLength(_msg);
+      this->payload.resize(length);
+      if (length > 0)
+      {
+        ros::serialization::OStream stream(&this->payload[0], length);
+        ros::serialization::serialize(stream, _msg);
+      }
+      this->WriteRecord(_tick, _time, _source, _type);
+    }
+
+    /// \brief Constructor, use Open().
+    private: explicit CommandLogWriter(FILE *_file);
+
+    /// \brief Write the record header and this->payload.  Caller holds
+    /// this->mutex.
+    private: void WriteRecord(uint64_t _tick, const common::Time &_time,
+                              uint8_t _source, uint8_t _type);
+
+    /// \brief Log file.
+    private: FILE *file;
+
+    /// \brief stdio buffer of the file, so the update threads writing
+    /// records rarely reach the disk.
+    private: std::vector<char> fileBuffer;
+
+    /// \brief Serialization buffer, reused between records.
+    private: std::vector<uint8_t> payload;
+
+    /// \brief Record buffer, reused between records.
+    private: std::vector<uint8_t> record;
+
+    /// \brief Serializes writers from different threads and plugins.
+    private: boost::mutex mutex;
+  };
+
+  /// \brief Reads back a command log for replay.
+  class CommandLogReader
+  {
+    /// \brief Constructor.
+    public: CommandLogReader();
+
+    /// \brief Read all records of one source from a log file.
+    /// \param[in] _path Log file name.
+    /// \param[in] _source Only records of this source are kept.
+    /// \return False if the file can't be read or is not a command log.
+    public: bool Load(const std::string &_path, uint8_t _source);
+
+    /// \brief Get the next record if it is due.
+    /// \param[in] _tick Current world iteration count.
+    /// \param[out] _record Next record with a tick <= _tick.
+    /// \return False if no record is due yet.
+    public: bool Next(uint64_t _tick, CommandRecord &_record);
+
+    /// \brief All records have been handed out.
+    public: bool Done() const;
+
+    /// \brief Number of records loaded.
+    public: size_t Size() const;
+
+    /// \brief Deserialize the message held by a record.
+    /// \param[in] _record Record to decode.
+    /// \return Newly allocated message.
+    public: template<class M>
+            static boost::shared_ptr<M> Decode(const CommandRecord &_record)
+    {
+      boost::shared_ptr<M> msg(new M());
+      if (!_record.payload.empty())
+      {
+        ros::serialization::IStream stream(
+          const_cast<uint8_t *>(&_record.payload[0]),
+          _record.payload.size());
+        ros::serialization::deserialize(stream, *msg);
+      }
+      return msg;
+    }
+
+    /// \brief Records in log order.
+    private: std::vector<CommandRecord> records;
+
+    /// \brief Index of the next record to hand out.
+    private: size_t next;
+  };
+
+  /// \brief Look up a command log file name.  The environment variable
+  /// wins over the plugin SDF element, so one variable can point every
+  /// plugin in a world at the same log.
+  /// \param[in] _sdf Plugin SDF.
+  /// \param[in] _element SDF element holding the file name.
+  /// \param[in] _envVar Environment variable holding the file name.
+  /// \return The file name, empty if neither is set.
+  std::string GetCommandLogPath(sdf::ElementPtr _sdf,
+                                const std::string &_element,
+                                const char *_envVar);
+}
+#endif
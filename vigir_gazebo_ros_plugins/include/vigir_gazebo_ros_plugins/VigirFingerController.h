@@ -0,0 +1,134 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GAZEBO_VIGIR_FINGER_CONTROLLER_HH
+#define GAZEBO_VIGIR_FINGER_CONTROLLER_HH
+
+#include <vector>
+
+#include <gazebo/common/PID.hh>
+#include <gazebo/physics/physics.hh>
+
+namespace gazebo
+{
+  /// \brief Drives the finger joints of a hand to target positions, either
+  /// with a PID per joint whose output is applied with SetForce, or with
+  /// the physics engine joint velocity motors.  Shared by the Robotiq hand
+  /// plugin and vigir_robotiq_hand_autotune, so the tuner's trials run the
+  /// plugin's control code.
+  ///
+  /// Usage: Init() with the joints, set the gains and effort limits, then
+  /// on every controller update Update(), and Hold() on the physics steps
+  /// in between.
+  class FingerController
+  {
+    /// \brief Joint actuation backends.
+    public: enum Actuation
+    {
+      PidActuation = 0,
+      MotorActuation
+    };
+
+    /// \brief Constructor.
+    public: FingerController();
+
+    /// \brief Set the joints to drive, the PIDs start with the default
+    /// gains and the joint effort limits.
+    /// \param[in] _joints the joints.
+    /// \param[in] _actuation how the joints are driven.
+    public: void Init(const physics::Joint_V &_joints, Actuation _actuation);
+
+    /// \brief How the joints are driven.
+    /// \return the actuation backend.
+    public: Actuation GetActuation() const;
+
+    /// \brief Set the PID gains of one joint.
+    /// \param[in] _index joint index.
+    /// \param[in] _kp P gain.
+    /// \param[in] _ki I gain.
+    /// \param[in] _kd D gain.
+    public: void SetGains(unsigned int _index, double _kp, double _ki,
+                          double _kd);
+
+    /// \brief Set the PID output limits of all joints, the upper one also
+    /// limits the motor force.
+    /// \param[in] _min lower limit, 0 uses minus the joint effort limit.
+    /// \param[in] _max upper limit, 0 uses the joint effort limit.
+    public: void SetEffortLimits(double _min, double _max);
+
+    /// \brief Start the PIDs over and drop the held efforts.
+    public: void Reset();
+
+    /// \brief Drive the joints towards their targets.
+    /// \param[in] _angles current joint angles [rad], by joint index.
+    /// \param[in] _targets target joint angles [rad], by joint index.
+    /// \param[in] _speeds largest motor speeds [rad/s], by joint index.
+    /// \param[in] _dt time since the last update [s].
+    public: void Update(const double *_angles, const double *_targets,
+                        const double *_speeds, double _dt);
+
+    /// \brief Reapply the efforts of the last update, zero-order hold on
+    /// the physics steps between two updates.
+    public: void Hold();
+
+    /// \brief Leave the joints free until the next Update().
+    public: void Disable();
+
+    /// \brief Effort the joint was driven with on the last physics step:
+    /// the held PID effort, or the motor constraint torque along the joint
+    /// axis.  Joint::GetForce is cleared by the step and is never set for
+    /// the motors.
+    /// \param[in] _index joint index.
+    /// \return effort [Nm].
+    public: double GetEffort(unsigned int _index) const;
+
+    /// \brief Position error of the last update.
+    /// \param[in] _index joint index.
+    /// \return current minus target angle [rad].
+    public: double GetError(unsigned int _index) const;
+
+    /// \brief PID of one joint, e.g. to log its parameters.
+    /// \param[in] _index joint index.
+    /// \return the PID.
+    public: const common::PID &GetPID(unsigned int _index) const;
+
+    /// \brief Enable or disable the joint velocity motors.
+    /// \param[in] _enabled false leaves the joints free.
+    private: void SetMotorsEnabled(bool _enabled);
+
+    /// \brief Driven joints.
+    private: physics::Joint_V joints;
+
+    /// \brief PIDs, by joint index.
+    private: std::vector<common::PID> pids;
+
+    /// \brief Efforts of the last update, by joint index.
+    private: std::vector<double> efforts;
+
+    /// \brief Position errors of the last update, by joint index.
+    private: std::vector<double> errors;
+
+    /// \brief How the joints are driven.
+    private: Actuation actuation;
+
+    /// \brief The joint motors currently have their force limit set.
+    private: bool motorsEnabled;
+
+    /// \brief False after Disable(), until the next Update().
+    private: bool enabled;
+  };
+}
+#endif
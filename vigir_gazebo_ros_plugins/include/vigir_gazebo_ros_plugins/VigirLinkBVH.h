@@ -0,0 +1,128 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GAZEBO_VIGIR_LINK_BVH_HH
+#define GAZEBO_VIGIR_LINK_BVH_HH
+
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <gazebo/math/Vector3.hh>
+#include <gazebo/physics/physics.hh>
+
+namespace gazebo
+{
+  /// \brief Bounding volume hierarchy over the collision bounding boxes of a
+  /// set of links, for nearest link queries.  Build() sorts the links into a
+  /// binary tree once, Refit() updates the boxes in place as the links move
+  /// and keeps the tree shape, so it is cheap enough to call every tick.
+  /// Rebuild when links are added or removed.  Links are held weakly, a
+  /// deleted link is never returned and its box stays empty until the
+  /// rebuild.
+  class LinkBVH
+  {
+    /// \brief Decides if a link may be returned by Nearest().
+    public: typedef boost::function<bool (const physics::LinkPtr &)> Filter;
+
+    /// \brief Constructor.
+    public: LinkBVH();
+
+    /// \brief Build the tree.
+    /// \param[in] _links links to index.
+    public: void Build(const physics::Link_V &_links);
+
+    /// \brief Update all boxes to the current link poses.
+    public: void Refit();
+
+    /// \brief Clear the tree.
+    public: void Clear();
+
+    /// \brief Find the link whose bounding box is closest to a point.
+    /// \param[in] _point query point in the world frame.
+    /// \param[in] _maxDistance ignore links farther away than this.
+    /// \param[in] _filter skip links it returns false for, may be empty.
+    /// \return the closest link, NULL if there is none within _maxDistance.
+    public: physics::LinkPtr Nearest(const math::Vector3 &_point,
+                                     double _maxDistance,
+                                     const Filter &_filter) const;
+
+    /// \brief Number of indexed links.
+    /// \return number of links.
+    public: size_t Size() const;
+
+    /// \brief Axis aligned box.
+    private: struct Bounds
+    {
+      /// \brief Minimum corner.
+      math::Vector3 min;
+
+      /// \brief Maximum corner.
+      math::Vector3 max;
+    };
+
+    /// \brief Tree node.  Children always come after their parent in nodes,
+    /// so walking the nodes backwards visits children first.
+    private: struct Node
+    {
+      /// \brief Box around everything below this node.
+      Bounds bounds;
+
+      /// \brief Index of the children, -1 for a leaf.
+      int left;
+      int right;
+
+      /// \brief Index into links for a leaf, -1 otherwise.
+      int link;
+    };
+
+    /// \brief Build the subtree over order[_begin, _end).
+    /// \param[in] _begin first leaf.
+    /// \param[in] _end one past the last leaf.
+    /// \return index of the subtree root.
+    private: int BuildNode(size_t _begin, size_t _end);
+
+    /// \brief Bounding box of a link.
+    /// \param[in] _link the link, may be NULL.
+    /// \return its collision bounding box, an inverted box that is
+    /// farther than any point for NULL.
+    private: static Bounds LinkBounds(const physics::LinkPtr &_link);
+
+    /// \brief Squared distance from a point to a box, 0 inside.
+    /// \param[in] _point the point.
+    /// \param[in] _bounds the box.
+    /// \return squared distance.
+    private: static double SquaredDistance(const math::Vector3 &_point,
+                                           const Bounds &_bounds);
+
+    /// \brief Indexed links.
+    private: std::vector<boost::weak_ptr<physics::Link> > links;
+
+    /// \brief Link boxes, by link index.  Used while building.
+    private: std::vector<Bounds> linkBounds;
+
+    /// \brief Link box centers, by link index.  Used while building.
+    private: std::vector<math::Vector3> centers;
+
+    /// \brief Link indices, partitioned while building.
+    private: std::vector<int> order;
+
+    /// \brief Tree nodes, the root is nodes[0].
+    private: std::vector<Node> nodes;
+  };
+}
+#endif
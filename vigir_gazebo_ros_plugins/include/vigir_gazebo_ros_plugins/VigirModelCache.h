@@ -0,0 +1,76 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GAZEBO_VIGIR_MODEL_CACHE_HH
+#define GAZEBO_VIGIR_MODEL_CACHE_HH
+
+#include <stdint.h>
+
+#include <string>
+
+namespace gazebo
+{
+  /// \brief On-disk cache of model descriptions converted to SDF, keyed by
+  /// a hash of the description and of the sdformat library that converted
+  /// it.  Spawning the same URDF again then skips the URDF to SDF
+  /// conversion, upgrading sdformat starts over.
+  ///
+  /// The cache lives in VIGIR_MODEL_CACHE, ~/.gazebo/vigir_model_cache by
+  /// default.  Setting VIGIR_MODEL_CACHE to "off" disables it.  Entries
+  /// are written to a temporary file and renamed, so concurrent launches
+  /// sharing the directory are safe.  Only the MaxEntries most recently
+  /// used entries are kept, the directory may also be deleted at any
+  /// time.
+  class ModelCache
+  {
+    /// \brief Most entries kept in the cache directory.
+    public: static const unsigned int MaxEntries = 32;
+
+    /// \brief Convert a model description to SDF, or read the SDF cached
+    /// for it.
+    /// \param[in] _description URDF or SDF model description.
+    /// \param[out] _sdf the SDF.
+    /// \return false if the description couldn't be converted.
+    public: static bool ToSDF(const std::string &_description,
+                              std::string &_sdf);
+
+    /// \brief The cache directory.
+    /// \return the directory, empty if caching is off.
+    public: static std::string Directory();
+
+    /// \brief 64 bit FNV-1a hash.
+    /// \param[in] _data data to hash.
+    /// \return the hash.
+    public: static uint64_t Hash(const std::string &_data);
+
+    /// \brief Identifies the sdformat library doing the conversion: its
+    /// version and the file, size and modification time of the loaded
+    /// library, so a rebuilt library with the same version misses too.
+    /// \return the id.
+    private: static std::string ConverterId();
+
+    /// \brief Delete all but the MaxEntries most recently used entries,
+    /// and temporary files left behind by crashed launches.
+    /// \param[in] _dir cache directory.
+    private: static void Prune(const std::string &_dir);
+
+    /// \brief Create a directory and its parents.
+    /// \param[in] _path directory path.
+    /// \return false if it doesn't exist afterwards.
+    private: static bool MakeDirectories(const std::string &_path);
+  };
+}
+#endif
@@ -0,0 +1,367 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GAZEBO_VIGIR_PLUGIN_EXECUTOR_HH
+#define GAZEBO_VIGIR_PLUGIN_EXECUTOR_HH
+
+#include <deque>
+#include <vector>
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace gazebo
+{
+  class ExecutorQueue;
+
+  /// \brief Process wide pool of a few threads running the ROS callbacks
+  /// and the publishes of all plugins, so the thread count doesn't grow
+  /// with the number of hands and robots.  The pool size is taken from
+  /// VIGIR_PLUGIN_EXECUTOR_THREADS, 2 by default.
+  ///
+  /// Plugins use an ExecutorQueue as their callback queue and an
+  /// AsyncPublisher per topic instead of running their own threads.
+  class PluginExecutor
+  {
+    /// \brief The executor, started on first use.
+    /// \return the executor.
+    public: static PluginExecutor &Instance();
+
+    /// \brief Shared reference to the executor, started on first use.  An
+    /// ExecutorQueue holds one, so the executor outlives the queues that
+    /// are destroyed during exit after the static one is gone.
+    /// \return the executor.
+    public: static boost::shared_ptr<PluginExecutor> Get();
+
+    /// \brief Run a function on one of the pool threads.
+    /// \param[in] _task the function.
+    public: void Post(const boost::function<void ()> &_task);
+
+    /// \brief Number of pool threads.
+    /// \return thread count.
+    public: unsigned int ThreadCount() const;
+
+    /// \brief Constructor, starts the threads.
+    private: PluginExecutor();
+
+    /// \brief Destructor, runs the remaining tasks and joins the threads.
+    private: ~PluginExecutor();
+
+    /// \brief Deleter of the shared executor.
+    /// \param[in] _executor the executor.
+    private: static void Destroy(PluginExecutor *_executor);
+
+    /// \brief Queue a run of the available callbacks of a queue, unless
+    /// one is queued or running already.
+    /// \param[in] _queue the queue.
+    private: void Schedule(ExecutorQueue *_queue);
+
+    /// \brief Stop scheduling a queue and wait for its callbacks to return.
+    /// Called from one of the queue's own callbacks it doesn't wait, the
+    /// pool thread drops the queue once the callback returned.
+    /// \param[in] _queue the queue.
+    private: void Remove(ExecutorQueue *_queue);
+
+    /// \brief Pool thread.
+    private: void Run();
+
+    /// \brief Pending work, a callback queue or a posted function.
+    private: struct Task
+    {
+      /// \brief Queue to call the available callbacks of, or NULL.
+      ExecutorQueue *queue;
+
+      /// \brief Posted function, if queue is NULL.
+      boost::function<void ()> function;
+    };
+
+    /// \brief Pending work, in order.
+    private: std::deque<Task> tasks;
+
+    /// \brief Protects tasks and the scheduling state of the queues.
+    private: boost::mutex mutex;
+
+    /// \brief Signaled on new tasks and on shutdown.
+    private: boost::condition_variable taskCondition;
+
+    /// \brief Signaled when a queue stops running.
+    private: boost::condition_variable idleCondition;
+
+    /// \brief Pool threads.
+    private: boost::thread_group threads;
+
+    /// \brief Number of pool threads.
+    private: unsigned int threadCount;
+
+    /// \brief Cleared on shutdown.
+    private: bool running;
+
+    friend class ExecutorQueue;
+  };
+
+  /// \brief Callback queue serviced by the PluginExecutor.  The callbacks
+  /// of one queue never run concurrently, like with a dedicated spinner
+  /// thread, but the pool thread is only taken while there are callbacks.
+  class ExecutorQueue : public ros::CallbackQueue
+  {
+    /// \brief Constructor.
+    public: ExecutorQueue();
+
+    /// \brief Destructor, calls Shutdown().
+    public: virtual ~ExecutorQueue();
+
+    /// \brief Drop the pending callbacks and wait for a running one to
+    /// return.  Shut down the subscribers and services using the queue
+    /// before.  From a callback of this queue it returns right away and
+    /// the queue isn't run again after the current run; the queue must
+    /// not be destroyed from its own callbacks.
+    public: void Shutdown();
+
+    /// \brief Add a callback and schedule the queue.
+    /// \param[in] _callback the callback.
+    /// \param[in] _ownerId id to remove it by.
+    public: virtual void addCallback(
+      const ros::CallbackInterfacePtr &_callback, uint64_t _ownerId = 0);
+
+    /// \brief A run of the queue is pending or running.
+    private: bool scheduled;
+
+    /// \brief A pool thread is calling the callbacks.
+    private: bool running;
+
+    /// \brief Pool thread calling the callbacks, while running.
+    private: boost::thread::id runningThread;
+
+    /// \brief The queue is being destroyed.
+    private: bool removed;
+
+    /// \brief Executor scheduling the queue.
+    private: boost::shared_ptr<PluginExecutor> executor;
+
+    friend class PluginExecutor;
+  };
+
+  /// \brief Publishes from the PluginExecutor, so a slow transport never
+  /// blocks the physics thread.  Messages of one publisher go out in
+  /// order, if the transport falls behind the oldest are dropped.
+  ///
+  /// The messages come from a pool: Allocate() hands out a message the
+  /// transport has released, so a publisher filling its messages in place
+  /// doesn't allocate once the pool has grown to its working size.
+  template <class M>
+  class AsyncPublisher
+  {
+    /// \brief Most messages waiting to be published.
+    public: static const unsigned int MaxPending = 100;
+
+    /// \brief Most pooled messages, beyond it Allocate() returns messages
+    /// that are freed after publishing.
+    public: static const unsigned int MaxSlots = MaxPending + 4;
+
+    /// \brief Constructor.
+    public: AsyncPublisher()
+      : state(new State()), nextSlot(0)
+    {
+      this->slots.reserve(MaxSlots);
+    }
+
+    /// \brief Destructor, pending messages are dropped.
+    public: ~AsyncPublisher()
+    {
+      this->Shutdown();
+    }
+
+    /// \brief Set the publisher the messages go out on.
+    /// \param[in] _publisher advertised publisher.
+    /// \param[in] _prototype initial contents of the pooled messages, e.g.
+    /// with the names and array sizes filled in.
+    public: void Init(const ros::Publisher &_publisher,
+                      const M &_prototype = M())
+    {
+      this->prototype = _prototype;
+      this->slots.clear();
+      this->nextSlot = 0;
+
+      boost::mutex::scoped_lock lock(this->state->mutex);
+      this->state->publisher = _publisher;
+    }
+
+    /// \brief A message to fill in and Publish().  A new message is a copy
+    /// of the prototype, a reused one holds what it was last published
+    /// with.  Call from the publishing thread only.
+    /// \return the message.
+    public: boost::shared_ptr<M> Allocate()
+    {
+      // a slot only referenced by the pool is neither pending nor held by
+      // the transport
+      for (size_t n = 0; n < this->slots.size(); ++n)
+      {
+        size_t i = (this->nextSlot + n) % this->slots.size();
+        if (this->slots[i].unique())
+        {
+          this->nextSlot = (i + 1) % this->slots.size();
+          return this->slots[i];
+        }
+      }
+
+      boost::shared_ptr<M> msg(new M(this->prototype));
+      if (this->slots.size() < MaxSlots)
+        this->slots.push_back(msg);
+      return msg;
+    }
+
+    /// \brief Queue a message from Allocate(), it must not be changed
+    /// afterwards.
+    /// \param[in] _msg the message.
+    public: void Publish(const boost::shared_ptr<const M> &_msg)
+    {
+      {
+        boost::mutex::scoped_lock lock(this->state->mutex);
+        if (!this->state->publisher)
+          return;
+
+        this->state->Push(_msg);
+        if (this->state->scheduled)
+          return;
+        this->state->scheduled = true;
+      }
+      PluginExecutor::Instance().Post(
+        boost::bind(&AsyncPublisher::Flush, this->state));
+    }
+
+    /// \brief Queue a copy of a message, made into a pooled message.
+    /// \param[in] _msg the message.
+    public: void Publish(const M &_msg)
+    {
+      boost::shared_ptr<M> msg = this->Allocate();
+      *msg = _msg;
+      this->Publish(boost::shared_ptr<const M>(msg));
+    }
+
+    /// \brief The publisher is set and not shut down.
+    /// \return true if Publish() sends messages.
+    public: bool IsPublishing() const
+    {
+      boost::mutex::scoped_lock lock(this->state->mutex);
+      return this->state->publisher ? true : false;
+    }
+
+    /// \brief Drop pending messages and shut the publisher down.
+    public: void Shutdown()
+    {
+      boost::mutex::scoped_lock lock(this->state->mutex);
+      this->state->Clear();
+      this->state->publisher.shutdown();
+      this->state->publisher = ros::Publisher();
+    }
+
+    /// \brief Shared with the posted flushes, which may outlive the
+    /// AsyncPublisher.
+    private: struct State
+    {
+      /// \brief Constructor.
+      State() : pending(MaxPending), first(0), count(0), scheduled(false) {}
+
+      /// \brief Append a pending message, dropping the oldest if full.
+      /// \param[in] _msg the message.
+      void Push(const boost::shared_ptr<const M> &_msg)
+      {
+        if (this->count == MaxPending)
+          this->Pop().reset();
+        this->pending[(this->first + this->count) % MaxPending] = _msg;
+        ++this->count;
+      }
+
+      /// \brief Remove the oldest pending message, count must not be 0.
+      /// \return the message.
+      boost::shared_ptr<const M> Pop()
+      {
+        boost::shared_ptr<const M> msg;
+        msg.swap(this->pending[this->first]);
+        this->first = (this->first + 1) % MaxPending;
+        --this->count;
+        return msg;
+      }
+
+      /// \brief Drop the pending messages.
+      void Clear()
+      {
+        while (this->count > 0)
+          this->Pop();
+      }
+
+      /// \brief Protects the other members.
+      boost::mutex mutex;
+
+      /// \brief Publisher, empty after Shutdown().
+      ros::Publisher publisher;
+
+      /// \brief Ring of messages waiting to be published.
+      std::vector<boost::shared_ptr<const M> > pending;
+
+      /// \brief Index of the oldest pending message.
+      size_t first;
+
+      /// \brief Number of pending messages.
+      size_t count;
+
+      /// \brief A flush is posted.
+      bool scheduled;
+    };
+
+    /// \brief Publish the pending messages, on a pool thread.
+    /// \param[in] _state publisher state.
+    private: static void Flush(boost::shared_ptr<State> _state)
+    {
+      while (true)
+      {
+        boost::shared_ptr<const M> msg;
+        ros::Publisher publisher;
+        {
+          boost::mutex::scoped_lock lock(_state->mutex);
+          if (_state->count == 0 || !_state->publisher)
+          {
+            _state->scheduled = false;
+            return;
+          }
+          msg = _state->Pop();
+          publisher = _state->publisher;
+        }
+        publisher.publish(msg);
+      }
+    }
+
+    /// \brief Publisher state.
+    private: boost::shared_ptr<State> state;
+
+    /// \brief Pooled messages, only used by the publishing thread.
+    private: std::vector<boost::shared_ptr<M> > slots;
+
+    /// \brief Slot Allocate() looks at first.
+    private: size_t nextSlot;
+
+    /// \brief Initial contents of new messages.
+    private: M prototype;
+  };
+}
+#endif
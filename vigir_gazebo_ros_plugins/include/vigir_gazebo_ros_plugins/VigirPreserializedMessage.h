@@ -0,0 +1,194 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GAZEBO_VIGIR_PRESERIALIZED_MESSAGE_HH
+#define GAZEBO_VIGIR_PRESERIALIZED_MESSAGE_HH
+
+#include <string.h>
+
+#include <vector>
+
+#include <ros/message_traits.h>
+#include <ros/ros.h>
+#include <ros/serialization.h>
+#include <sensor_msgs/JointState.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace gazebo
+{
+  /// \brief A message of type M kept serialized.  It is advertised and
+  /// published like an M, subscribers receive an M, but publishing only
+  /// copies the bytes.
+  template <class M>
+  struct PreserializedMessage
+  {
+    typedef boost::shared_ptr<PreserializedMessage<M> > Ptr;
+    typedef boost::shared_ptr<PreserializedMessage<M> const> ConstPtr;
+
+    /// \brief Serialized M.
+    std::vector<uint8_t> data;
+  };
+
+  /// \brief A serialized JointState whose names and array sizes don't
+  /// change.  The stamp and the arrays are patched into copies of the
+  /// serialized template, so the names are serialized only once.
+  class JointStateTemplate
+  {
+    /// \brief Serialized JointState.
+    public: typedef PreserializedMessage<sensor_msgs::JointState> Message;
+
+    /// \brief Constructor, Init() before use.
+    public: JointStateTemplate();
+
+    /// \brief Serialize the template.
+    /// \param[in] _msg the template, its position, velocity and effort
+    /// arrays must be as long as its names.
+    /// \return false if the arrays have different lengths.
+    public: bool Init(const sensor_msgs::JointState &_msg);
+
+    /// \brief The serialized template.
+    /// \return the template.
+    public: const Message &Prototype() const;
+
+    /// \brief Number of joints.
+    /// \return the length of the arrays.
+    public: size_t Size() const;
+
+    /// \brief Patch the header stamp.  Does nothing if _msg is too short
+    /// to be a copy of the template.
+    /// \param[in,out] _msg a copy of the template.
+    /// \param[in] _stamp the stamp.
+    public: void SetStamp(Message &_msg, const ros::Time &_stamp) const;
+
+    /// \brief Patch the state of a joint.  Does nothing if _msg is too
+    /// short to be a copy of the template.
+    /// \param[in,out] _msg a copy of the template.
+    /// \param[in] _index joint index, less than Size().
+    /// \param[in] _position joint position.
+    /// \param[in] _velocity joint velocity.
+    /// \param[in] _effort joint effort.
+    public: void SetJoint(Message &_msg, size_t _index, double _position,
+                          double _velocity, double _effort) const;
+
+    /// \brief The serialized template.
+    private: Message prototype;
+
+    /// \brief Number of joints.
+    private: size_t size;
+
+    /// \brief Byte offset of the header stamp.
+    private: size_t stampOffset;
+
+    /// \brief Byte offset of the first position.
+    private: size_t positionOffset;
+
+    /// \brief Byte offset of the first velocity.
+    private: size_t velocityOffset;
+
+    /// \brief Byte offset of the first effort.
+    private: size_t effortOffset;
+  };
+}
+
+namespace ros
+{
+namespace message_traits
+{
+  /// \brief A PreserializedMessage is advertised as the message it holds.
+  template <class M>
+  struct MD5Sum<gazebo::PreserializedMessage<M> >
+  {
+    static const char *value()
+    {
+      return MD5Sum<M>::value();
+    }
+
+    static const char *value(const gazebo::PreserializedMessage<M> &)
+    {
+      return MD5Sum<M>::value();
+    }
+  };
+
+  template <class M>
+  struct DataType<gazebo::PreserializedMessage<M> >
+  {
+    static const char *value()
+    {
+      return DataType<M>::value();
+    }
+
+    static const char *value(const gazebo::PreserializedMessage<M> &)
+    {
+      return DataType<M>::value();
+    }
+  };
+
+  template <class M>
+  struct Definition<gazebo::PreserializedMessage<M> >
+  {
+    static const char *value()
+    {
+      return Definition<M>::value();
+    }
+
+    static const char *value(const gazebo::PreserializedMessage<M> &)
+    {
+      return Definition<M>::value();
+    }
+  };
+
+  template <class M>
+  struct HasHeader<gazebo::PreserializedMessage<M> > : public HasHeader<M>
+  {
+  };
+}
+
+namespace serialization
+{
+  /// \brief Serializing a PreserializedMessage copies its bytes.
+  template <class M>
+  struct Serializer<gazebo::PreserializedMessage<M> >
+  {
+    template <typename Stream>
+    inline static void write(Stream &_stream,
+                             const gazebo::PreserializedMessage<M> &_msg)
+    {
+      if (!_msg.data.empty())
+      {
+        memcpy(_stream.advance(_msg.data.size()), &_msg.data[0],
+               _msg.data.size());
+      }
+    }
+
+    template <typename Stream>
+    inline static void read(Stream &_stream,
+                            gazebo::PreserializedMessage<M> &_msg)
+    {
+      uint32_t length = _stream.getLength();
+      _msg.data.assign(_stream.getData(), _stream.getData() + length);
+      _stream.advance(length);
+    }
+
+    inline static uint32_t serializedLength(
+      const gazebo::PreserializedMessage<M> &_msg)
+    {
+      return _msg.data.size();
+    }
+  };
+}
+}
+#endif
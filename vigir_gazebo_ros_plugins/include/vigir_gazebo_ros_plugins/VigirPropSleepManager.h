@@ -0,0 +1,125 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GAZEBO_VIGIR_PROP_SLEEP_MANAGER_HH
+#define GAZEBO_VIGIR_PROP_SLEEP_MANAGER_HH
+
+#include <vector>
+
+#include <gazebo/math/Box.hh>
+#include <gazebo/math/Vector3.hh>
+#include <gazebo/physics/physics.hh>
+
+namespace gazebo
+{
+  /// \brief Puts task props the robot is far away from to sleep.  A prop
+  /// sleeps once all its links have been at rest for a while outside the
+  /// radius around the robot: its links are disabled, so the physics
+  /// engine skips them until something touches them.  It wakes up when the
+  /// robot comes within the radius or the engine re-enables one of its
+  /// links on contact.
+  ///
+  /// Usage: AddModel() the props, SetRadius() and SetRest(), then Update()
+  /// every world update.
+  class PropSleepManager
+  {
+    /// \brief Constructor, sleeping is off until SetRadius().
+    public: PropSleepManager();
+
+    /// \brief Wake and forget all props.
+    public: void Clear();
+
+    /// \brief Manage a model, static models are ignored.
+    /// \param[in] _model the model.
+    public: void AddModel(const physics::ModelPtr &_model);
+
+    /// \brief Set how far the robot must be for props to sleep.
+    /// \param[in] _radius distance to the prop bounding box [m], 0 turns
+    /// sleeping off and wakes all props.
+    public: void SetRadius(double _radius);
+
+    /// \brief Set when a prop counts as at rest.
+    /// \param[in] _linearVelocity largest link speed [m/s].
+    /// \param[in] _angularVelocity largest link angular speed [rad/s].
+    /// \param[in] _restTime time at rest before sleeping [s].
+    public: void SetRest(double _linearVelocity, double _angularVelocity,
+                         double _restTime);
+
+    /// \brief Put props to sleep and wake them up.
+    /// \param[in] _robotPosition robot position.
+    /// \param[in] _time current sim time.
+    public: void Update(const math::Vector3 &_robotPosition, double _time);
+
+    /// \brief Wake all props, e.g. after moving them.
+    public: void WakeAll();
+
+    /// \brief Number of sleeping props.
+    /// \return sleeping prop count.
+    public: unsigned int SleepingCount() const;
+
+    /// \brief A managed model.
+    private: struct Prop
+    {
+      /// \brief The model.
+      physics::ModelPtr model;
+
+      /// \brief Its links.
+      physics::Link_V links;
+
+      /// \brief The links are disabled.
+      bool asleep;
+
+      /// \brief Sim time the prop came to rest, < 0 if moving.
+      double restStart;
+
+      /// \brief Bounding box when it fell asleep.
+      math::Box box;
+    };
+
+    /// \brief Check whether all links of a prop are at rest.
+    /// \param[in] _prop the prop.
+    /// \return true if at rest.
+    private: bool AtRest(const Prop &_prop) const;
+
+    /// \brief Distance from a point to a box.
+    /// \param[in] _box the box.
+    /// \param[in] _point the point.
+    /// \return 0 inside the box.
+    private: static double Distance(const math::Box &_box,
+                                    const math::Vector3 &_point);
+
+    /// \brief Enable or disable the links of a prop.
+    /// \param[in] _prop the prop.
+    /// \param[in] _asleep true to disable them.
+    private: static void SetAsleep(Prop &_prop, bool _asleep);
+
+    /// \brief Managed props.
+    private: std::vector<Prop> props;
+
+    /// \brief Sleep radius, 0 if off.
+    private: double radius;
+
+    /// \brief Largest link speed at rest.
+    private: double linearVelocity;
+
+    /// \brief Largest link angular speed at rest.
+    private: double angularVelocity;
+
+    /// \brief Time at rest before sleeping.
+    private: double restTime;
+  };
+}
+#endif
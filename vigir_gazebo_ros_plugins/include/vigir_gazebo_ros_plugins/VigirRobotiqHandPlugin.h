@@ -19,7 +19,7 @@
 
 #include <atlas_msgs/SModelRobotInput.h>
 #include <atlas_msgs/SModelRobotOutput.h>
-#include <gazebo_plugins/PubQueue.h>
+#include <dynamic_reconfigure/server.h>
 #include <ros/advertise_options.h>
 #include <ros/callback_queue.h>
 #include <ros/ros.h>
@@ -28,11 +28,18 @@
 #include <string>
 #include <vector>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
-#include <gazebo/common/PID.hh>
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/common/Time.hh>
 #include <gazebo/physics/physics.hh>
+#include <vigir_gazebo_ros_plugins/RobotiqHandConfig.h>
+#include <vigir_gazebo_ros_plugins/VigirAsyncLog.h>
+#include <vigir_gazebo_ros_plugins/VigirCommandLog.h>
+#include <vigir_gazebo_ros_plugins/VigirFingerController.h>
+#include <vigir_gazebo_ros_plugins/VigirPluginExecutor.h>
+#include <vigir_gazebo_ros_plugins/VigirPreserializedMessage.h>
+#include <vigir_gazebo_ros_plugins/VigirSnapshotRegistry.h>
 
 /// \brief A plugin that implements the Robotiq 3-Finger Adaptative Gripper.
 /// The plugin exposes the next parameters via SDF tags:
@@ -44,14 +51,37 @@
 ///                   of the joints. This parameter is optional.
 ///   * <kd_position> D gain for the PID that controls the position
 ///                   of the joints. This parameter is optional.
+///   * <joint_gain> Gains of one joint, overriding the ones above. Contains
+///                  <joint> (the joint name, with or without the side
+///                  prefix, e.g. f2_j1) and any of <kp>, <ki> and <kd>.
+///                  Repeat it for more joints, vigir_robotiq_hand_autotune
+///                  writes these. This parameter is optional.
 ///   * <position_effort_min> Minimum output of the PID that controls the
 ///                           position of the joints. This parameter is optional
 ///   * <position_effort_max> Maximum output of the PID that controls the
 ///                           position of the joints. This parameter is optional
+///   * <actuation> How the joints are driven towards their targets: 'pid'
+///                 applies the PID output with SetForce, 'motor' commands
+///                 the physics engine joint velocity motors, limited to
+///                 position_effort_max, which stays stable at larger physics
+///                 steps. This parameter is optional, default 'pid'.
+///   * <control_rate> Rate (Hz) of the state machine, the PID update and
+///                    the state publishers. The PID efforts are held on the
+///                    physics steps in between. This parameter is optional,
+///                    0 (the default) updates on every physics step.
 ///   * <topic_command> ROS topic name used to send new commands to the hand.
 ///                     This parameter is optional.
 ///   * <topic_state> ROS topic name used to receive state from the hand.
 ///                   This parameter is optional.
+///   * <command_log> File to record the incoming hand commands to. The
+///                   VRC_COMMAND_LOG environment variable overrides it.
+///                   This parameter is optional.
+///   * <replay_log> Command log to replay instead of listening to ROS. The
+///                  VRC_REPLAY_LOG environment variable overrides it.
+///                  This parameter is optional.
+/// The gains, tolerances and the control and joint state rates can be
+/// changed at run time with dynamic_reconfigure on robotiq_hands/<side>_hand/,
+/// see cfg/RobotiqHand.cfg.  The SDF values are their initial values.
 class VigirRobotiqHandPlugin : public gazebo::ModelPlugin
 {
   /// \brief Hand states.
@@ -74,6 +104,9 @@ class VigirRobotiqHandPlugin : public gazebo::ModelPlugin
     Scissor
   };
 
+  /// \brief Tunables, generated from cfg/RobotiqHand.cfg.
+  private: typedef vigir_gazebo_ros_plugins::RobotiqHandConfig Config;
+
   /// \brief Constructor.
   public: VigirRobotiqHandPlugin();
 
@@ -83,15 +116,49 @@ class VigirRobotiqHandPlugin : public gazebo::ModelPlugin
   // Documentation inherited.
   public: void Load(gazebo::physics::ModelPtr _parent, sdf::ElementPtr _sdf);
 
-  /// \brief ROS callback queue thread.
-  private: void RosQueueThread();
+  /// \brief Seed the tunables from the SDF, then serve them with
+  /// dynamic_reconfigure if ROS is up.
+  private: void LoadConfig();
+
+  /// \brief dynamic_reconfigure callback, runs on a PluginExecutor thread.
+  /// \param[in] _config New tunables.
+  /// \param[in] _level Unused.
+  private: void OnReconfigure(Config &_config, uint32_t _level);
+
+  /// \brief Copy the tunables into the controller if they changed since
+  /// the last call. The caller holds the controlMutex.
+  private: void ApplyConfig();
+
+  /// \brief Read the <joint_gain> elements into gainOverrides.
+  private: void LoadJointGains();
 
   /// \brief ROS topic callback to update Robotiq Hand Control Commands.
+  /// The command is queued and applied by the next UpdateStates, so it is
+  /// recorded with the tick it takes effect at.
   /// \param[in] _msg Incoming ROS message with the next hand command.
   private: void SetHandleCommand(
     const atlas_msgs::SModelRobotOutput::ConstPtr &_msg);
 
-  /// \brief Update PID Joint controllers.
+  /// \brief Verify, record and store a new hand command. The caller holds
+  /// the controlMutex.
+  /// \param[in] _msg The new hand command.
+  private: void ApplyHandleCommand(
+    const atlas_msgs::SModelRobotOutput::ConstPtr &_msg);
+
+  /// \brief Apply the commands of the replay log that are due this tick.
+  /// The caller holds the controlMutex.
+  private: void ReplayCommands();
+
+  /// \brief Serialize the hand command state for a world snapshot.
+  /// \param[out] _buffer Saved state.
+  private: void SaveState(std::vector<uint8_t> &_buffer);
+
+  /// \brief Restore the hand command state from a world snapshot.
+  /// \param[in] _buffer State saved by SaveState.
+  private: void RestoreState(const std::vector<uint8_t> &_buffer);
+
+  /// \brief Compute the finger targets of the hand state and drive the
+  /// fingers towards them.
   /// \param[in] _dt time step size since last update.
   private: void UpdatePIDControl(double _dt);
 
@@ -104,6 +171,9 @@ class VigirRobotiqHandPlugin : public gazebo::ModelPlugin
   /// \brief Update the controller.
   private: void UpdateStates();
 
+  /// \brief Read the state of all joints into jointSnapshot.
+  private: void ReadJointStates();
+
   /// \brief Grab pointers to all the joints.
   /// \return true on success, false otherwise.
   private: bool FindJoints();
@@ -119,8 +189,7 @@ class VigirRobotiqHandPlugin : public gazebo::ModelPlugin
   private: bool IsHandFullyOpen();
 
   /// \brief Internal helper to get the object detection value.
-  /// \param[in] _joint Finger joint.
-  /// \param[in] _index Index of the position PID for this joint.
+  /// \param[in] _index Index of the finger joint.
   /// \param[in] _rPR Current position request.
   /// \param[in] _prevrPR Previous position request.
   /// \return The information on possible object contact:
@@ -128,14 +197,14 @@ class VigirRobotiqHandPlugin : public gazebo::ModelPlugin
   /// 1 Finger has stopped due to a contact while opening.
   /// 2 Finger has stopped due to a contact while closing.
   /// 3 Finger is at the requested position.
-  private: uint8_t GetObjectDetection(const gazebo::physics::JointPtr &_joint,
-                                    int _index, uint8_t _rPR, uint8_t _prevrPR);
+  private: uint8_t GetObjectDetection(int _index, uint8_t _rPR,
+                                      uint8_t _prevrPR);
 
   /// \brief Internal helper to get the actual position of the finger.
-  /// \param[in] _joint Finger joint.
+  /// \param[in] _index Index of the finger joint.
   /// \return The actual position of the finger. 0 is the minimum position
   /// (fully open) and 255 is the maximum position (fully closed).
-  private: uint8_t GetCurrentPosition(const gazebo::physics::JointPtr &_joint);
+  private: uint8_t GetCurrentPosition(int _index);
 
   /// \brief Internal helper to reduce code duplication. If the joint name is
   /// found, a pointer to the joint is added to a vector of joint pointers.
@@ -166,15 +235,6 @@ class VigirRobotiqHandPlugin : public gazebo::ModelPlugin
   /// Fingers 1 and 2 can do circumduction in one axis.
   private: static const int NumJoints = 11;
 
-  /// \brief Velocity tolerance. Below this value we assume that the joint is
-  /// stopped (rad/s).
-  private: static const double VelTolerance = 0.002;
-
-  /// \brief Position tolerance. If the difference between target position and
-  /// current position is within this value we'll conclude that the joint
-  /// reached its target (rad).
-  private: static const double PoseTolerance = 0.002;
-
   /// \brief Min. joint speed (rad/s). Finger is 125mm and tip speed is 22mm/s.
   private: static const double MinVelocity = 0.176;
 
@@ -196,14 +256,8 @@ class VigirRobotiqHandPlugin : public gazebo::ModelPlugin
   /// \brief ROS NodeHandle.
   private: boost::scoped_ptr<ros::NodeHandle> rosNode;
 
-  /// \brief ROS callback queue.
-  private: ros::CallbackQueue rosQueue;
-
-  /// \brief ROS callback queue thread.
-  private: boost::thread callbackQueueThread;
-
-  // ROS publish multi queue, prevents publish() blocking
-  private: PubMultiQueue pmq;
+  /// \brief ROS callback queue, serviced by the PluginExecutor.
+  private: gazebo::ExecutorQueue rosQueue;
 
   /// \brief ROS control interface
   private: ros::Subscriber subHandleCommand;
@@ -242,21 +296,20 @@ class VigirRobotiqHandPlugin : public gazebo::ModelPlugin
   /// \brief Hand state.
   private: State handState;
 
-  /// \brief ROS publisher for Robotiq Hand state.
-  private: ros::Publisher pubHandleState;
-
-  /// \brief ROS publisher queue for Robotiq Hand state.
-  private: PubQueue<atlas_msgs::SModelRobotInput>::Ptr pubHandleStateQueue;
+  /// \brief ROS publisher for Robotiq Hand state, publish() never blocks.
+  private: gazebo::AsyncPublisher<atlas_msgs::SModelRobotInput>
+    pubHandleState;
 
   /// \brief Joint state publisher (rviz visualization).
-  private: ros::Publisher pubJointStates;
+  private: gazebo::AsyncPublisher<gazebo::JointStateTemplate::Message>
+    pubJointStates;
 
-  /// \brief ROS publisher queue for joint states.
-  private: PubQueue<sensor_msgs::JointState>::Ptr pubJointStatesQueue;
-
-  /// \brief ROS joint state message.
+  /// \brief ROS joint state message, the names of the published ones.
   private: sensor_msgs::JointState jointStates;
 
+  /// \brief Serialized jointStates, patched for every publish.
+  private: gazebo::JointStateTemplate jointStateTemplate;
+
   /// \brief World pointer.
   private: gazebo::physics::WorldPtr world;
 
@@ -278,8 +331,91 @@ class VigirRobotiqHandPlugin : public gazebo::ModelPlugin
   /// \brief Vector containing all the joints.
   private: gazebo::physics::Joint_V joints;
 
-  /// \brief PIDs used to control the finger positions.
-  private: gazebo::common::PID posePID[NumJoints];
+  /// \brief Drives fingerJoints, with the actuation from <actuation>.
+  private: gazebo::FingerController fingerControl;
+
+  /// \brief Per joint gains from <joint_gain>.
+  private: struct GainOverride
+  {
+    /// \brief P, I and D gain, < 0 to use the hand wide gain.
+    double kp;
+    double ki;
+    double kd;
+  };
+
+  /// \brief Gain overrides, by joint index.
+  private: GainOverride gainOverrides[NumJoints];
+
+  /// \brief Joint states of a controller update, read in one pass and
+  /// shared by the state machine, the controller and the publishers.
+  private: struct JointSnapshot
+  {
+    /// \brief Angles [rad], by joint index.
+    double angle[NumJoints];
+
+    /// \brief Velocities [rad/s], by joint index.
+    double velocity[NumJoints];
+
+    /// \brief Efforts applied over the last physics step, by joint index.
+    double force[NumJoints];
+  };
+
+  /// \brief Joint states of the current controller update.
+  private: JointSnapshot jointSnapshot;
+
+  /// \brief Joint lower limits [rad], by joint index, read on Load.
+  private: double lowerLimits[NumJoints];
+
+  /// \brief Joint upper limits [rad], by joint index, read on Load.
+  private: double upperLimits[NumJoints];
+
+  /// \brief Source tag of this hand in the command log.
+  private: gazebo::CommandSource commandSource;
+
+  /// \brief Command log written while running, NULL if not recording.
+  private: boost::shared_ptr<gazebo::CommandLogWriter> commandLog;
+
+  /// \brief Command log being replayed, NULL if not replaying.
+  private: boost::scoped_ptr<gazebo::CommandLogReader> commandReplay;
+
+  /// \brief Commands received since the last update, in arrival order.
+  /// Protected by the controlMutex.
+  private: std::vector<atlas_msgs::SModelRobotOutput::ConstPtr>
+    pendingCommands;
+
+  /// \brief Name in the SnapshotRegistry, empty if not registered.
+  private: std::string snapshotName;
+
+  /// \brief Latest tunables, replaced as a whole by OnReconfigure and read
+  /// with boost::atomic_load.
+  private: boost::shared_ptr<const Config> config;
+
+  /// \brief Tunables ApplyConfig copied last.
+  private: boost::shared_ptr<const Config> appliedConfig;
+
+  /// \brief Serves the tunables.
+  private: boost::scoped_ptr<dynamic_reconfigure::Server<Config> >
+    reconfigureServer;
+
+  /// \brief Velocity tolerance. Below this value we assume that the joint is
+  /// stopped (rad/s).
+  private: double velTolerance;
+
+  /// \brief Position tolerance. If the difference between target position and
+  /// current position is within this value we'll conclude that the joint
+  /// reached its target (rad).
+  private: double poseTolerance;
+
+  /// \brief Minimum time between joint state messages, 0 publishes every
+  /// update (s).
+  private: double jointStatePeriod;
+
+  /// \brief Minimum time between controller updates, 0 updates every
+  /// physics step.
+  private: gazebo::common::Time controlPeriod;
+
+  /// \brief Sim time of the last joint state message.
+  private: gazebo::common::Time lastJointStateTime;
 };
 
 #endif  // GAZEBO_VIGIR_ROBOTIQ_HAND_PLUGIN_HH
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GAZEBO_VIGIR_SNAPSHOT_REGISTRY_HH
+#define GAZEBO_VIGIR_SNAPSHOT_REGISTRY_HH
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace gazebo
+{
+  /// \brief Plugin state saved with a world snapshot, keyed by plugin name.
+  typedef std::map<std::string, std::vector<uint8_t> > PluginStates;
+
+  /// \brief Process-wide registry of plugin state that is not part of the
+  /// physics state, e.g. the Robotiq hand command state.  VRCPlugin saves
+  /// and restores every registered plugin together with the world.
+  /// Save and restore functions are called from the world update thread.
+  class SnapshotRegistry
+  {
+    /// \brief Serializes the plugin state into the buffer.
+    public: typedef boost::function<void (std::vector<uint8_t> &)> SaveFunc;
+
+    /// \brief Restores the plugin state from a buffer filled by SaveFunc.
+    public: typedef boost::function<void (const std::vector<uint8_t> &)>
+            RestoreFunc;
+
+    /// \brief Get the registry.
+    /// \return The process-wide registry.
+    public: static SnapshotRegistry &Instance();
+
+    /// \brief Register a plugin, replaces an earlier one of the same name.
+    /// \param[in] _name Unique plugin name, e.g. "left_hand".
+    /// \param[in] _save Save function.
+    /// \param[in] _restore Restore function.
+    public: void Register(const std::string &_name, const SaveFunc &_save,
+                          const RestoreFunc &_restore);
+
+    /// \brief Remove a plugin, call before the plugin is destroyed.
+    /// \param[in] _name Plugin name.
+    public: void Unregister(const std::string &_name);
+
+    /// \brief Save the state of every registered plugin.
+    /// \param[out] _states Saved states.
+    public: void Save(PluginStates &_states);
+
+    /// \brief Restore saved states.  Plugins without a saved state and
+    /// saved states without a plugin are skipped.
+    /// \param[in] _states States filled by Save().
+    public: void Restore(const PluginStates &_states);
+
+    /// \brief Registered plugins.
+    private: std::map<std::string, std::pair<SaveFunc, RestoreFunc> > plugins;
+
+    /// \brief Protects plugins.
+    private: boost::mutex mutex;
+  };
+}
+#endif
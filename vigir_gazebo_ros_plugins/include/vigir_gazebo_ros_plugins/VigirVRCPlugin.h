@@ -18,8 +18,10 @@
 #ifndef GAZEBO_VRC_PLUGIN_HH
 #define GAZEBO_VRC_PLUGIN_HH
 
+#include <deque>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <ros/ros.h>
@@ -35,8 +37,13 @@
 #include <atlas_msgs/AtlasSimInterfaceCommand.h>
 #include <atlas_msgs/AtlasSimInterfaceState.h>
 
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
 
 #include <gazebo/math/Vector3.hh>
 #include <gazebo/physics/physics.hh>
@@ -45,10 +52,24 @@
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/common/Events.hh>
 
+#include <dynamic_reconfigure/server.h>
+
+#include <vigir_gazebo_ros_plugins/VRCPluginConfig.h>
+#include <vigir_gazebo_ros_plugins/VigirAsyncLog.h>
+#include <vigir_gazebo_ros_plugins/VigirCollisionProfiles.h>
+#include <vigir_gazebo_ros_plugins/VigirCommandLog.h>
+#include <vigir_gazebo_ros_plugins/VigirLinkBVH.h>
+#include <vigir_gazebo_ros_plugins/VigirPluginExecutor.h>
+#include <vigir_gazebo_ros_plugins/VigirPropSleepManager.h>
+#include <vigir_gazebo_ros_plugins/VigirSnapshotRegistry.h>
+
 namespace gazebo
 {
   class VRCPlugin : public WorldPlugin
   {
+    /// \brief Tunables, generated from cfg/VRCPlugin.cfg.
+    private: typedef vigir_gazebo_ros_plugins::VRCPluginConfig Config;
+
     /// \brief Constructor
     public: VRCPlugin();
 
@@ -101,11 +122,16 @@ namespace gazebo
     public: void SetRobotModeTopic(const std_msgs::String::ConstPtr &_str);
 
     /// \brief sets robot mode
-    /// \param[in] _str sets robot mode by a string.  Supported modes are:
+    /// \param[in] _str sets robot mode by a string.  Built-in modes are:
     ///  - "no_gravity" Gravity disabled for the robot.
     ///  - "nominal" Nominal "normal" physics.
     ///  - "pinned" Robot is pinned to inertial world by the pelvis.
+    ///  - "pinned_with_gravity" pinned with gravity enabled.
     ///  - "feet" same as no_gravity except for r_foot and l_foot links.
+    ///  - "harnessed" lowered to the ground, upright and pinned.
+    ///  - "pid_stand" pinned in the BDI stand pose.
+    /// The modes are a table, see LoadRobotModes, and switching only
+    /// applies what differs from the current state.
     public: void SetRobotMode(const std::string &_str);
 
     /// \brief Accepts BDI behavior library commands and fakes them
@@ -131,6 +157,66 @@ namespace gazebo
     /// \param[in] _cmd not used.
     public: void RobotReleaseLink(const geometry_msgs::Pose::ConstPtr &_cmd);
 
+    /// \brief Weld a link to one of the robot hands where it is.
+    /// \param[in] _hand "left" or "right".
+    /// \param[in] _target "model::link", or "model" for its canonical link.
+    /// If empty, the nearest link of another dynamic model within
+    /// grabMaxDistance of the hand is grabbed.
+    /// \return false if the hand or target wasn't found.
+    public: bool RobotGrab(const std::string &_hand,
+                           const std::string &_target);
+
+    /// \brief ROS callback for RobotGrab, the message is
+    /// "<hand> [<target>]".
+    /// \param[in] _cmd the grab command.
+    public: void RobotGrabTopic(const std_msgs::String::ConstPtr &_cmd);
+
+    /// \brief Save the state of the robot, the task props and every plugin
+    /// in the SnapshotRegistry under a name.  Must be called from the world
+    /// update thread, the ROS topic queues it to the next tick.
+    /// \param[in] _name Snapshot name, an older snapshot is replaced.
+    public: void SaveSnapshot(const std::string &_name);
+
+    /// \brief Restore a snapshot taken by SaveSnapshot within one paused
+    /// tick.  Must be called from the world update thread.
+    /// \param[in] _name Snapshot name.
+    /// \return false if there is no snapshot of that name.
+    public: bool RestoreSnapshot(const std::string &_name);
+
+    /// \brief ROS callback for SaveSnapshot.
+    /// \param[in] _name Snapshot name.
+    public: void SaveSnapshotTopic(const std_msgs::String::ConstPtr &_name);
+
+    /// \brief ROS callback for RestoreSnapshot.
+    /// \param[in] _name Snapshot name.
+    public: void RestoreSnapshotTopic(const std_msgs::String::ConstPtr &_name);
+
+    /// \brief Place the robot and any number of models within one paused
+    /// tick.  One entry per line, '#' starts a comment, poses are
+    /// "x y z roll pitch yaw":
+    ///   robot <pose>          pin link pose, the robot stays pinned if it
+    ///                         is, and is taken out of the vehicle
+    ///   vehicle <pose>        the DRC vehicle
+    ///   fire_hose <pose>      the fire hose, standpipe and valve models
+    ///   standpipe <pose>
+    ///   valve <pose>
+    ///   valve_angle <angle>   valve joint angle [rad]
+    ///   model <name> <pose>   any model of the world
+    /// Grabs and the hose screw joint are released.  Nothing is applied if
+    /// an entry is malformed or names a missing model.  Must be called from
+    /// the world update thread.
+    /// \param[in] _layout the layout.
+    /// \return false if the layout wasn't applied.
+    public: bool ApplyLayout(const std::string &_layout);
+
+    /// \brief ROS callback for ApplyLayout with the layout in a file.
+    /// \param[in] _path layout file path.
+    public: void LoadLayoutTopic(const std_msgs::String::ConstPtr &_path);
+
+    /// \brief ROS callback for ApplyLayout.
+    /// \param[in] _layout the layout.
+    public: void SetLayoutTopic(const std_msgs::String::ConstPtr &_layout);
+
 
     ////////////////////////////////////////////////////////////////////////////
     //                                                                        //
@@ -180,6 +266,58 @@ namespace gazebo
     /// \param[in] _joint Joint to remove.
     private: void RemoveJoint(physics::JointPtr &_joint);
 
+    /// \brief Re-seat an attached joint at the current pose of its child
+    /// link, without loading it again.
+    /// \param[in] _joint the joint.
+    /// \param[in] _anchor anchor offset from the child link.
+    /// \param[in] _axis joint axis.
+    private: void ReseatJoint(const physics::JointPtr &_joint,
+                              const math::Vector3 &_anchor,
+                              const math::Vector3 &_axis);
+
+    /// \brief World edit transaction.  Pose, joint and configuration edits
+    /// made while a WorldEdit is alive are applied with the world paused and
+    /// the physics engine off.  Transactions nest, only the outermost one
+    /// pauses and restores the world, so a mode switch that removes two
+    /// joints, moves the robot and adds a pin costs a single pause.
+    /// A deferred transaction does not pause by itself, it only holds back
+    /// the restore of the edits made inside it until it ends.  UpdateStates
+    /// opens one per tick, so all edits of a tick commit together.
+    /// Only used from the world update thread; edits requested from other
+    /// threads are queued with OnCommand.
+    private: class WorldEdit
+    {
+      /// \brief Constructor, opens the transaction.
+      /// \param[in] _plugin plugin owning the world.
+      /// \param[in] _deferred don't pause, only batch nested edits.
+      public: WorldEdit(VRCPlugin *_plugin, bool _deferred = false)
+              : plugin(_plugin), deferred(_deferred)
+      {
+        this->plugin->BeginWorldEdit(this->deferred);
+      }
+
+      /// \brief Destructor, closes the transaction.
+      public: ~WorldEdit()
+      {
+        this->plugin->EndWorldEdit(this->deferred);
+      }
+
+      /// \brief Plugin owning the world.
+      private: VRCPlugin *plugin;
+
+      /// \brief Opened as a deferred transaction.
+      private: bool deferred;
+    };
+    friend class WorldEdit;
+
+    /// \brief Open a world edit transaction, see WorldEdit.
+    /// \param[in] _deferred don't pause, only batch nested edits.
+    private: void BeginWorldEdit(bool _deferred);
+
+    /// \brief Close a world edit transaction, see WorldEdit.
+    /// \param[in] _deferred the transaction was opened deferred.
+    private: void EndWorldEdit(bool _deferred);
+
     /// \brief setup Robot ROS publication and sbuscriptions for the Robot
     /// These ros api describes Robot only actions
     private: void LoadRobotROSAPI();
@@ -190,16 +328,150 @@ namespace gazebo
     ///                      messages from the cmd_vel
     private: void LoadVRCROSAPI();
 
+    /// \brief Create the screw joint between standpipe spout and hose
+    /// coupling.
+    private: void AddScrewJoint();
+
     /// \brief check and spawn screw joint to simulate threads
     /// if links are aligned
     private: void CheckThreadStart();
 
+    /// \brief Read the poses, velocities and joint angles used by the
+    /// stages of UpdateStates into frame.
+    private: void ReadFrameState();
+
+    /// \brief World state of the current update, read in one pass.  A
+    /// stage that moves something updates it for the later stages.
+    private: struct FrameState
+    {
+      /// \brief The robot pin link exists, the robot members are set.
+      bool robotValid;
+
+      /// \brief Pin link pose and linear velocity.
+      math::Pose pinPose;
+      math::Vector3 pinLinearVel;
+
+      /// \brief The l_foot and r_foot links exist.
+      bool footValid[2];
+
+      /// \brief l_foot and r_foot poses.
+      math::Pose footPose[2];
+
+      /// \brief The fire hose is loaded, the hose members are set.
+      bool hoseValid;
+
+      /// \brief Hose coupling and standpipe spout link poses.
+      math::Pose couplingPose;
+      math::Pose spoutPose;
+
+      /// \brief Valve angle, 0 without a valve.
+      double valveAngle;
+
+      /// \brief Screw joint angle, 0 without a screw joint.
+      double screwAngle;
+    };
+
+    /// \brief World state of the current update.
+    private: FrameState frame;
+
     /// \brief: thread out Load function with
     /// with anything that might be blocking.
     private: void DeferredLoad();
 
-    /// \brief ROS callback queue thread
-    private: void ROSQueueThread();
+    /// \brief Build the startup phase table from the startup mode, the
+    /// startup profile and the per phase tunables, which the
+    /// atlas/startup/<phase>/ params seed.
+    /// \param[in] _config tunables.
+    private: void LoadStartupPhases(const Config &_config);
+
+    /// \brief Seed the tunables from the plugin sdf and the legacy params,
+    /// then serve them with dynamic_reconfigure on vrc_plugin/.
+    private: void LoadConfig();
+
+    /// \brief dynamic_reconfigure callback, runs on a PluginExecutor thread.
+    /// \param[in] _config new tunables.
+    /// \param[in] _level unused.
+    private: void OnReconfigure(Config &_config, uint32_t _level);
+
+    /// \brief Copy the tunables into the plugin if they changed since the
+    /// last call.  Runs once per world update.
+    private: void ApplyConfig();
+
+    /// \brief Advance the startup sequence.
+    /// \param[in] _curTime current sim time.
+    private: void UpdateStartupPhases(double _curTime);
+
+    /// \brief Run the action of the current startup phase.
+    /// \param[in] _curTime current sim time.
+    private: void BeginStartupPhase(double _curTime);
+
+    /// \brief Command types stored in the command log.  Values are written
+    /// to disk, only append new ones.
+    private: enum CommandType
+    {
+      CMD_VEL = 0,
+      CMD_POSE,
+      CMD_CONFIGURATION,
+      CMD_MODE,
+      CMD_FAKE_ASIC,
+      CMD_ENTER_CAR,
+      CMD_EXIT_CAR,
+      CMD_GRAB,
+      CMD_RELEASE,
+      CMD_SAVE_SNAPSHOT,
+      CMD_RESTORE_SNAPSHOT,
+      CMD_GRAB_LINK,
+      CMD_LOAD_LAYOUT,
+      CMD_SET_LAYOUT
+    };
+
+    /// \brief Queue an incoming ROS command.  It is stamped with the next
+    /// tick UpdateStates processes and applied at the start of that tick,
+    /// so the sim time it reads and the order of the commands only depend
+    /// on the ticks they arrive at, and a replay of the command log applies
+    /// them at the same ticks.  The edits of all commands applied in a
+    /// tick commit in one WorldEdit.
+    /// \param[in] _type command type, used when recording.
+    /// \param[in] _handler VRCPlugin method that applies the command.
+    /// \param[in] _msg the incoming command.
+    private: template<class M>
+             void OnCommand(CommandType _type,
+                            void (VRCPlugin::*_handler)(
+                              const boost::shared_ptr<M const> &),
+                            const boost::shared_ptr<M const> &_msg)
+    {
+      QueuedCommand command;
+      command.apply = boost::bind(&VRCPlugin::ApplyCommand<M>, this, _type,
+                                  _handler, _msg);
+      boost::mutex::scoped_lock lock(this->commandQueueMutex);
+      command.tick = this->nextCommandTick;
+      this->commandQueue.push_back(command);
+    }
+
+    /// \brief Record a command if a command log is open, then apply it.
+    /// \param[in] _type command type.
+    /// \param[in] _handler VRCPlugin method that applies the command.
+    /// \param[in] _msg the command.
+    private: template<class M>
+             void ApplyCommand(CommandType _type,
+                               void (VRCPlugin::*_handler)(
+                                 const boost::shared_ptr<M const> &),
+                               const boost::shared_ptr<M const> &_msg)
+    {
+      if (this->commandLog)
+      {
+        this->commandLog->Write(this->world->GetIterations(),
+          this->world->GetSimTime(), CS_VRC, _type, *_msg);
+      }
+      (this->*_handler)(_msg);
+    }
+
+    /// \brief Apply the commands queued by OnCommand for this tick, in
+    /// arrival order.  Called from UpdateStates.
+    private: void ProcessCommandQueue();
+
+    /// \brief Apply the commands of the replay log that are due this tick.
+    private: void ReplayCommands();
 
     /// \brief Helper for pinning Atlas to the world.
     /// \param[in] _with_gravity Whether to enable gravity on the robot's
@@ -209,10 +481,81 @@ namespace gazebo
     /// \brief Helper for unpinning Atlas to the world.
     private: void UnpinAtlas();
 
-    /// \brief Helper for disabling foot collisions
-    /// \param[in] _mode collision mode; will be passed to
-    ///   gazebo::physics::Link::SetCollideMode()
-    private: void SetFeetCollide(const std::string &_mode);
+    /// \brief Lower the robot to the ground, upright it and pin it.
+    private: void HarnessAtlas();
+
+    /// \brief Build the robot mode table.  The built-in modes can be
+    /// changed and new ones added with params under atlas/modes:
+    ///  - names: list of additional modes, they start out like nominal.
+    ///  - <name>/pin: "none", "current" (pin where the robot is) or
+    ///    "harness" (see HarnessAtlas).
+    ///  - <name>/gravity: gravity of the robot links.
+    ///  - <name>/gravity_except: links with the opposite gravity.
+    ///  - <name>/collision_profile: profile from LoadCollisionProfiles,
+    ///    empty to leave the collisions alone.
+    ///  - <name>/kinematic: use the kinematic subtrees.
+    ///  - <name>/posture: "pid_stand", "seated", "standing" or empty.
+    ///  - <name>/gains: param namespace of controller gains to load.
+    private: void LoadRobotModes();
+
+    /// \brief How a robot mode pins the robot.
+    private: enum PinMode
+    {
+      PIN_NONE = 0,
+      PIN_CURRENT,
+      PIN_HARNESS
+    };
+
+    /// \brief One entry of the robot mode table.
+    private: struct RobotMode
+    {
+      /// \brief Mode name.
+      std::string name;
+
+      /// \brief Pin state.
+      PinMode pin;
+
+      /// \brief Gravity of the robot links.
+      bool gravity;
+
+      /// \brief Links with the opposite gravity.
+      std::vector<std::string> gravityExcept;
+
+      /// \brief Gravity of each atlas link, computed from the above.
+      std::vector<bool> linkGravity;
+
+      /// \brief Collision profile name, empty for no change.
+      std::string collisionProfile;
+
+      /// \brief collisionProfile looked up in collisionProfiles.
+      CollisionProfiles::Id profile;
+
+      /// \brief Use the kinematic subtrees.
+      bool kinematic;
+
+      /// \brief Posture commanded when switching to the mode.
+      std::string posture;
+
+      /// \brief Param namespace of gains loaded when switching to the mode.
+      std::string gains;
+    };
+
+    /// \brief Robot mode table.
+    private: std::vector<RobotMode> robotModes;
+
+    /// \brief Current robot mode, empty after the robot was pinned or moved
+    /// outside of SetRobotMode.
+    private: std::string robotMode;
+
+    /// \brief Compute the collision profiles of the robot and vehicle once
+    /// the robot is spawned: "nominal", "warp" (feet don't collide, used
+    /// for fake walking and while pinned) and "seated" (robot and cab
+    /// don't collide, used with <disable_cab_collision>).
+    private: void LoadCollisionProfiles();
+
+    /// \brief Switch the collision profile of robot and vehicle.
+    /// \param[in] _id profile from collisionProfiles.
+    private: void SetCollisionProfile(CollisionProfiles::Id _id);
 
     /// \brief Helper to convert step data to a planar cmd_vel-style Twist
     /// \param[in] _step the last step to be taken
@@ -252,6 +595,9 @@ namespace gazebo
       private: physics::LinkPtr pinLink;
       private: physics::JointPtr pinJoint;
 
+      /// \brief l_foot and r_foot links, for the fake behavior state.
+      private: physics::LinkPtr footLinks[2];
+
       private: std::string modelName;
       private: std::string pinLinkName;
 
@@ -265,39 +611,48 @@ namespace gazebo
       /// \brief Robot configuration when inside of vehicle.
       private: std::map<std::string, double> inVehicleConfiguration;
 
-      /// \brief  At t-t0 < startupStandPrepDuration seconds, pinned.
-      /// At t - t0 = startupStandPrepDurationl, start StandPrep mode.
-      private: double startupStandPrepDuration;
+      /// \brief What a startup phase does when it begins.
+      private: enum StartupAction {
+        SA_PID_STAND = 0,
+        SA_STAND_PREP,
+        SA_NOMINAL,
+        SA_STAND,
+        SA_PINNED
+      };
 
-      /// \brief at t - t0 = startupNominal, start Nominal mode.
-      private: double startupNominal;
+      /// \brief One phase of the startup sequence.  A phase ends after
+      /// duration seconds of sim time, or earlier once minDuration has
+      /// passed and every atlas joint is within jointTolerance of its
+      /// commanded position.
+      private: struct StartupPhase
+      {
+        /// \brief Phase name, params live in atlas/startup/<name>/.
+        std::string name;
 
-      /// \brief at t - t0 = startupStand, start Stand mode.
-      private: double startupStand;
+        /// \brief Action run when the phase begins.
+        StartupAction action;
 
-      /// \brief Flag to keep track of start-up 'bdi_stand' on the robot.
-      private: enum BDIStandSequence {
-        BS_NONE = 0,
-        BS_PID_PINNED = 1,
-        BS_STAND_PREP_PINNED = 2,
-        BS_STAND_PREP = 3,
-        BS_INITIALIZED = 4
-      };
-      private: int bdiStandSequence;
+        /// \brief Maximum time in this phase, < 0 to stay forever.
+        double duration;
 
-      /// \brief Flag to keep track of start-up 'pinned' mode
-      private: enum PinnedSequence {
-        PS_NONE = 0,
-        PS_PINNED = 1,
-        PS_INITIALIZED = 2
+        /// \brief Minimum time in this phase before convergence counts.
+        double minDuration;
+
+        /// \brief Joint convergence tolerance in rad, <= 0 disables it.
+        double jointTolerance;
       };
-      private: int pinnedSequence;
 
-      // mode flag to indicate nominal mode has already been called once.
-      private: bool bdiStandNominal;
+      /// \brief Startup phases, in order.
+      private: std::vector<StartupPhase> startupPhases;
+
+      /// \brief Index of the current startup phase.
+      private: size_t startupPhase;
 
-      /// \brief Keep track of start-up 'bdi_stand' time
-      private: common::Time startupBDIStandStartTime;
+      /// \brief Sim time the current startup phase began, < 0 if it hasn't.
+      private: double startupPhaseStartTime;
+
+      /// \brief Startup profile, default or fast.
+      private: std::string startupProfile;
 
       /// \brief allow user to set startup mode as bdi_stand or pinned
       private: std::string startupMode;
@@ -320,7 +675,9 @@ namespace gazebo
       private: ros::Subscriber subMode;
       private: ros::Subscriber subFakeASIC;
       /// \brief publisher of fake AtlasSimInterfaceState
-      private: ros::Publisher pubFakeASIS;
+      private: AsyncPublisher<atlas_msgs::AtlasSimInterfaceState> pubFakeASIS;
+      /// \brief USER behavior command sent on fake behavior requests
+      private: atlas_msgs::AtlasSimInterfaceCommand userBehaviorCommand;
       /// \brief current requested (fake) behavior
       private: int currentBehavior;
       /// \brief current (fake) step being pursued
@@ -350,9 +707,57 @@ namespace gazebo
       /// \brief flag for successful initialization of vehicle
       private: bool isInitialized;
 
+      /// \brief Keep the robot welded to seatLink while driving, set with
+      /// <drc_vehicle><weld_robot>.  Otherwise RobotEnterCar only places
+      /// the robot in the seat.
+      private: bool weldRobot;
+
+      /// \brief While welded, the robot doesn't collide with the vehicle,
+      /// <drc_vehicle><disable_cab_collision>.
+      private: bool disableCabCollision;
+
+      /// \brief While welded, the leg joints are locked at their seated
+      /// angles, <drc_vehicle><freeze_legs>.
+      private: bool freezeLegs;
+
       friend class VRCPlugin;
     } drcVehicle;
 
+    /// \brief Joint limits changed by WeldRobotToVehicle.
+    private: struct SavedJointStops
+    {
+      /// \brief The joint.
+      physics::JointPtr joint;
+
+      /// \brief Its upper limit before welding.
+      math::Angle high;
+
+      /// \brief Its lower limit before welding.
+      math::Angle low;
+    };
+
+    /// \brief Weld the seated robot to the vehicle seat and apply the
+    /// <drc_vehicle> weld options.
+    private: void WeldRobotToVehicle();
+
+    /// \brief Remove vehicleRobotJoint and undo the weld options.
+    private: void UnweldRobotFromVehicle();
+
+    /// \brief Collision bits of robot and vehicle links.
+    private: CollisionProfiles collisionProfiles;
+
+    /// \brief Puts the vehicle, fire hose and valve to sleep while the
+    /// robot is away from them, see the sleep_* tunables.
+    private: PropSleepManager propSleep;
+
+    /// \brief Ids of the profiles made by LoadCollisionProfiles.
+    private: CollisionProfiles::Id nominalProfile;
+    private: CollisionProfiles::Id warpProfile;
+    private: CollisionProfiles::Id seatedProfile;
+
+    /// \brief Leg joints while the legs are frozen, empty otherwise.
+    private: std::vector<SavedJointStops> savedLegStops;
+
     ////////////////////////////////////////////////////////////////////////////
     //                                                                        //
     //   DRC Fire Hose (and Standpipe)                                        //
@@ -391,12 +796,199 @@ namespace gazebo
       private: math::Pose couplingRelativePose;
       private: math::Pose initialFireHosePose;
 
+      /// \brief offset of the coupling cylinder surface from the coupling
+      /// link origin, read from attachment_col on Load.
+      private: double couplingSurfaceOffset;
+
       /// \brief flag for successful initialization of fire hose, standpipe
       private: bool isInitialized;
 
       friend class VRCPlugin;
     } drcFireHose;
 
+    ////////////////////////////////////////////////////////////////////////////
+    //                                                                        //
+    //   Dynamic joint pool                                                   //
+    //                                                                        //
+    ////////////////////////////////////////////////////////////////////////////
+    /// \brief Joints created by AddJoint, one per joint type and link pair
+    /// (pin, vehicle seat, grab, hose screw).  RemoveJoint detaches a joint
+    /// and hands it back; the next AddJoint for the same links attaches the
+    /// same physics joint again instead of creating, naming and loading a
+    /// new one.  Entries of deleted models are dropped, and idle entries are
+    /// evicted oldest first past MaxEntries, so the pool stays bounded
+    /// however often the robot is pinned, grabs or enters the vehicle.
+    private: class JointPool
+    {
+      /// \brief Create and name a joint ahead of time, does nothing if the
+      /// pool already has one for the link pair.
+      /// \param[in] _engine physics engine creating the joint.
+      /// \param[in] _model model the joint belongs to.
+      /// \param[in] _type joint type.
+      /// \param[in] _parent parent link, NULL for the world.
+      /// \param[in] _child child link.
+      private: void Reserve(physics::PhysicsEnginePtr _engine,
+                            physics::ModelPtr _model,
+                            const std::string &_type,
+                            physics::LinkPtr _parent,
+                            physics::LinkPtr _child);
+
+      /// \brief Get an idle joint for the link pair, creating one if the
+      /// pool has none.  The joint is not attached yet.
+      /// \param[in] _engine physics engine creating the joint.
+      /// \param[in] _model model the joint belongs to.
+      /// \param[in] _type joint type.
+      /// \param[in] _parent parent link, NULL for the world.
+      /// \param[in] _child child link.
+      /// \param[out] _loaded true if the joint was loaded by an earlier
+      /// AddJoint and only needs to be attached again.
+      /// \return the joint.
+      private: physics::JointPtr Acquire(physics::PhysicsEnginePtr _engine,
+                                         physics::ModelPtr _model,
+                                         const std::string &_type,
+                                         physics::LinkPtr _parent,
+                                         physics::LinkPtr _child,
+                                         bool &_loaded);
+
+      /// \brief Detach a joint and mark it idle.
+      /// \param[in] _joint joint returned by Acquire.
+      private: void Release(const physics::JointPtr &_joint);
+
+      /// \brief Drop the entries of deleted links or models, then evict
+      /// the oldest idle entries until there is room for a new one.
+      private: void Prune();
+
+      /// \brief Drop one entry and the references its joint holds in the
+      /// links.
+      /// \param[in] _index entry index.
+      private: void Erase(size_t _index);
+
+      /// \brief Create and name an idle joint.
+      /// \param[in] _engine physics engine creating the joint.
+      /// \param[in] _model model the joint belongs to.
+      /// \param[in] _type joint type.
+      /// \param[in] _parent parent link, NULL for the world.
+      /// \param[in] _child child link.
+      /// \return index of the new entry.
+      private: size_t Create(physics::PhysicsEnginePtr _engine,
+                             physics::ModelPtr _model,
+                             const std::string &_type,
+                             physics::LinkPtr _parent,
+                             physics::LinkPtr _child);
+
+      /// \brief Find the entry of a link pair.
+      /// \param[in] _type joint type.
+      /// \param[in] _parent parent link, NULL for the world.
+      /// \param[in] _child child link.
+      /// \param[in] _idleOnly skip joints that are attached.
+      /// \return entry index, or entries.size() if there is none.
+      private: size_t Find(const std::string &_type,
+                           const physics::LinkPtr &_parent,
+                           const physics::LinkPtr &_child,
+                           bool _idleOnly) const;
+
+      /// \brief One pooled joint.
+      private: struct Entry
+      {
+        /// \brief joint type.
+        std::string type;
+
+        /// \brief true if the parent is the world.
+        bool world;
+
+        /// \brief parent link, unset for the world.
+        boost::weak_ptr<physics::Link> parent;
+
+        /// \brief model of the parent link, unset for the world.
+        boost::weak_ptr<physics::Model> parentModel;
+
+        /// \brief child link.
+        boost::weak_ptr<physics::Link> child;
+
+        /// \brief model of the child link.
+        boost::weak_ptr<physics::Model> childModel;
+
+        /// \brief the joint.
+        physics::JointPtr joint;
+
+        /// \brief loaded by AddJoint.
+        bool loaded;
+
+        /// \brief attached by AddJoint.
+        bool inUse;
+      };
+
+      /// \brief Most entries kept, idle entries past it are evicted.
+      private: static const size_t MaxEntries = 32;
+
+      /// \brief Pooled joints, in creation order.
+      private: std::vector<Entry> entries;
+
+      friend class VRCPlugin;
+    } jointPool;
+
+    /// \brief Create the pin, vehicle seat, grab and hose screw joints in
+    /// the pool once the models they connect are loaded.
+    private: void ReserveJoints();
+
+    /// \brief Keep grabBVH up to date, rebuilt when models are added,
+    /// removed or switch between static and dynamic, refit otherwise.
+    private: void UpdateGrabBVH();
+
+    /// \brief Links RobotGrab may pick without a target: links of other
+    /// dynamic models that aren't grabbed already.
+    /// \param[in] _link candidate link.
+    /// \return true if the link can be grabbed.
+    private: bool IsGraspable(const physics::LinkPtr &_link) const;
+
+    /// \brief Index of the links of all dynamic models except atlas.
+    private: LinkBVH grabBVH;
+
+    /// \brief Id and static flag of the world models grabBVH was built
+    /// for, in world order.
+    private: std::vector<std::pair<uint32_t, bool> > grabBVHModels;
+
+    /// \brief RobotGrab without a target ignores links farther away from
+    /// the hand, set with <grab_max_distance>.
+    private: double grabMaxDistance;
+
+    /// \brief Joints welding grabbed links to the left and right hand.
+    private: physics::JointPtr handGrabJoints[2];
+
+    /// \brief Find the joints selected by the atlas/kinematic_subtrees
+    /// param, a list of joint name prefixes such as "l_leg_".
+    private: void LoadKinematicSubtrees();
+
+    /// \brief Switch the selected subtrees between kinematic and dynamic.
+    /// Used by the pinned, harnessed and pid_stand modes, where the pelvis
+    /// doesn't move and only the arms need full dynamics.
+    /// \param[in] _enable true to make them kinematic.
+    private: void SetKinematicSubtrees(bool _enable);
+
+    /// \brief Move the kinematic subtrees to the latest commanded joint
+    /// positions.  Called every update while they are enabled.
+    private: void UpdateKinematicSubtrees();
+
+    /// \brief Indices into atlasCommandController.jointNames of the joints
+    /// driven kinematically.
+    private: std::vector<unsigned int> kinematicJoints;
+
+    /// \brief Scoped names of kinematicJoints, as SetJointPositions expects.
+    private: std::vector<std::string> kinematicNames;
+
+    /// \brief Child links of kinematicJoints.
+    private: physics::Link_V kinematicLinks;
+
+    /// \brief Joint positions passed to SetJointPositions, by scoped joint
+    /// name.
+    private: std::map<std::string, double> kinematicPositions;
+
+    /// \brief Command the subtrees were last moved to.
+    private: atlas_msgs::AtlasCommand::ConstPtr kinematicCommand;
+
+    /// \brief True while the subtrees are kinematic.
+    private: bool kinematicSubtreesEnabled;
+
     ////////////////////////////////////////////////////////////////////////////
     //                                                                        //
     //   Robot Joint Controller                                               //
@@ -413,7 +1005,14 @@ namespace gazebo
 
       /// \brief: initialize AtlasCommandController with atlas model pointer
       /// \param[in] Atlas model pointer
-      private: void InitModel(physics::ModelPtr _model);
+      /// \param[in] _queue callback queue of the subscriptions
+      private: void InitModel(physics::ModelPtr _model,
+                              ros::CallbackQueue *_queue);
+
+      /// \brief Load the PID gains from params <_ns>/<joint>/p, i, d and
+      /// i_clamp.  They are sent with the next command.
+      /// \param[in] _ns param namespace.
+      private: void LoadGains(const std::string &_ns);
 
       /// \brief: atlas model pointer
       private: physics::ModelPtr model;
@@ -426,10 +1025,28 @@ namespace gazebo
       private: std::string FindJoint(std::string _st1, std::string _st2);
       private: std::string FindJoint(std::string _st1, std::string _st2, std::string _st3);
 
+      /// \brief Check if the atlas joints reached their commanded positions.
+      /// \param[in] _tolerance maximum position error in rad.
+      /// \return true if every joint is within _tolerance.
+      private: bool JointsConverged(double _tolerance) const;
+
       /// \brief subscriber to joint_states of the atlas robot
       private: void GetJointStates(
         const sensor_msgs::JointState::ConstPtr &_js);
 
+      /// \brief subscriber to atlas_command, keeps the latest command for
+      /// the kinematic subtrees.
+      private: void GetAtlasCommand(
+        const atlas_msgs::AtlasCommand::ConstPtr &_ac);
+
+      /// \brief latest command received on atlas_command.
+      /// \return the command, NULL if there was none yet.
+      private: atlas_msgs::AtlasCommand::ConstPtr GetLastCommand();
+
+      /// \brief latest joint states received on joint_states.
+      /// \return the joint states, NULL if there were none yet.
+      private: sensor_msgs::JointState::ConstPtr GetLastJointStates();
+
       /// \brief stand configuration with PID controller
       /// \param[in] pointer to atlas model
       private: void SetPIDStand(physics::ModelPtr atlasModel);
@@ -454,6 +1071,15 @@ namespace gazebo
       /// \brief subscriber to joint_states
       private: ros::Subscriber subJointStates;
 
+      /// \brief subscriber to atlas_command
+      private: ros::Subscriber subAtlasCommand;
+
+      /// \brief latest received AtlasCommand, see GetLastCommand.
+      private: atlas_msgs::AtlasCommand::ConstPtr lastCommand;
+
+      /// \brief protects lastCommand.
+      private: boost::mutex lastCommandMutex;
+
       /// \brief publisher of joint_commands
       private: ros::Publisher pubAtlasCommand;
 
@@ -470,9 +1096,16 @@ namespace gazebo
       private: sensor_msgs::JointState::ConstPtr js;
       private: bool js_valid;
 
+      /// \brief protects js and js_valid, SetFakeASIC reads them on the
+      /// physics thread.
+      private: boost::mutex jsMutex;
+
       /// \brief hardcoded joint names for atlas
       private: std::vector<std::string> jointNames;
 
+      /// \brief atlas joints, in jointNames order.
+      private: physics::Joint_V joints;
+
       /// \brief Atlas version number.
       private: int atlasVersion;
 
@@ -507,11 +1140,11 @@ namespace gazebo
 
     // default ros stuff
     private: ros::NodeHandle* rosNode;
-    private: ros::CallbackQueue rosQueue;
-    private: boost::thread callbackQueueThread;
+    private: ExecutorQueue rosQueue;
 
     // ros subscribers for robot actions
     private: ros::Subscriber subRobotGrab;
+    private: ros::Subscriber subRobotGrabLink;
     private: ros::Subscriber subRobotRelease;
     private: ros::Subscriber subRobotEnterCar;
     private: ros::Subscriber subRobotExitCar;
@@ -524,8 +1157,154 @@ namespace gazebo
     /// \brief Are cheats enabled?
     private: bool cheatsEnabled;
 
-    /// \brief time out when receiving fake teleop cmd_vel command
-    private: double cmdVelTopicTimeout;
+    /// \brief Latest tunables, replaced as a whole by OnReconfigure and
+    /// read with boost::atomic_load.
+    private: boost::shared_ptr<const Config> config;
+
+    /// \brief Tunables ApplyConfig copied last, physics thread only.
+    private: boost::shared_ptr<const Config> appliedConfig;
+
+    /// \brief Serves the tunables on vrc_plugin/.
+    private: boost::scoped_ptr<dynamic_reconfigure::Server<Config> >
+      reconfigureServer;
+
+    /// \brief Seat the robot in the vehicle at startup, from
+    /// robot_start_in_vehicle.
+    private: bool robotStartInVehicle;
+
+    /// \brief A command waiting for its tick.
+    private: struct QueuedCommand
+    {
+      /// \brief World iteration the command is applied at.
+      uint64_t tick;
+
+      /// \brief Records and applies the command.
+      boost::function<void ()> apply;
+    };
+
+    /// \brief Commands waiting for their tick.  Their ticks never
+    /// decrease, so the queue is in tick order and, within a tick, in
+    /// arrival order.
+    private: std::deque<QueuedCommand> commandQueue;
+
+    /// \brief Tick stamped on incoming commands, the one after the last
+    /// tick ProcessCommandQueue ran at.
+    private: uint64_t nextCommandTick;
+
+    /// \brief Protects commandQueue and nextCommandTick.
+    private: boost::mutex commandQueueMutex;
+
+    /// \brief Open WorldEdit transactions, not counting deferred ones.
+    private: int worldEditDepth;
+
+    /// \brief Open deferred WorldEdit transactions.
+    private: int worldEditDeferred;
+
+    /// \brief The world is paused for an edit.
+    private: bool worldEditActive;
+
+    /// \brief World paused state to restore after the edit.
+    private: bool worldEditPaused;
+
+    /// \brief Physics engine state to restore after the edit.
+    private: bool worldEditPhysics;
+
+    /// \brief Sim time at which the vehicle joint RobotExitCar keeps while
+    /// the robot settles is removed, negative if none is pending.
+    private: double vehicleRobotJointReleaseTime;
+
+    /// \brief Command log written while running, NULL if not recording.
+    private: boost::shared_ptr<CommandLogWriter> commandLog;
+
+    /// \brief Command log being replayed, NULL if not replaying.
+    private: boost::scoped_ptr<CommandLogReader> commandReplay;
+
+    /// \brief A dynamically created joint in a snapshot.
+    private: struct JointSnapshot
+    {
+      /// \brief The joint existed.
+      bool present;
+
+      /// \brief Parent link, NULL for the world.
+      physics::LinkPtr parent;
+
+      /// \brief Child link.
+      physics::LinkPtr child;
+    };
+
+    /// \brief Everything SaveSnapshot captures.
+    private: struct WorldSnapshot
+    {
+      /// \brief Robot and task prop models.
+      std::vector<physics::ModelPtr> models;
+
+      /// \brief Pose, link and joint state of each model.
+      std::vector<physics::ModelState> modelStates;
+
+      /// \brief Gravity mode of each atlas link.
+      std::vector<bool> atlasGravity;
+
+      /// \brief The kinematic subtrees were enabled.
+      bool kinematicSubtrees;
+
+      /// \brief Robot pin joint.
+      JointSnapshot pinJoint;
+
+      /// \brief Robot to vehicle seat joint.
+      JointSnapshot vehicleRobotJoint;
+
+      /// \brief The robot was welded to the vehicle by RobotEnterCar.
+      bool vehicleWeld;
+
+      /// \brief Time left until RobotExitCar releases vehicleRobotJoint,
+      /// -1 if it isn't held.
+      double vehicleReleaseDelay;
+
+      /// \brief Hand to fire hose coupling joint.
+      JointSnapshot grabJoint;
+
+      /// \brief Fire hose coupling to standpipe screw joint.
+      JointSnapshot screwJoint;
+
+      /// \brief Links welded to the left and right hand by RobotGrab.
+      JointSnapshot handGrabJoints[2];
+
+      /// \brief Collision profile.
+      CollisionProfiles::Id collisionProfile;
+
+      /// \brief Pin pose kept against z drift.
+      math::Pose atlasInitialPose;
+
+      /// \brief Fake walking state.
+      bool warpRobotWithCmdVel;
+      common::Time warpRobotStopTime;
+      geometry_msgs::Twist robotCmdVel;
+      int currentBehavior;
+      int currentStepIndex;
+      int lastStepIndex;
+
+      /// \brief Last command sent to the atlas controller.
+      atlas_msgs::AtlasCommand atlasCommand;
+
+      /// \brief State of plugins in the SnapshotRegistry.
+      PluginStates plugins;
+    };
+
+    /// \brief Capture the state of one dynamically created joint.
+    /// \param[in] _joint The joint, may be NULL.
+    /// \return The joint snapshot.
+    private: static JointSnapshot SaveJoint(const physics::JointPtr &_joint);
+
+    /// \brief Snapshots by name.
+    private: std::map<std::string, WorldSnapshot> snapshots;
+
+    // ros subscribers for snapshots
+    private: ros::Subscriber subSaveSnapshot;
+    private: ros::Subscriber subRestoreSnapshot;
+
+    // ros subscribers for layouts
+    private: ros::Subscriber subLoadLayout;
+    private: ros::Subscriber subSetLayout;
   };
 /** \} */
 /// @}
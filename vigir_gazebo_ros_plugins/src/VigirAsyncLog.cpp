@@ -0,0 +1,191 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <ros/console.h>
+#include <vigir_gazebo_ros_plugins/VigirAsyncLog.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+// Monotonic clock in nanoseconds.
+static int64_t MonotonicNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FNV-1a over a byte range.
+static uint64_t HashBytes(uint64_t _hash, const void *_data, size_t _size)
+{
+  const unsigned char *bytes = static_cast<const unsigned char *>(_data);
+  for (size_t i = 0; i < _size; ++i)
+  {
+    _hash ^= bytes[i];
+    _hash *= 1099511628211ULL;
+  }
+  return _hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+LogSite::LogSite(LogLevel _level, double _interval, bool _throttle,
+                 const char *_file, int _line)
+  : level(_level), file(_file), line(_line),
+    interval(static_cast<int64_t>(_interval * 1e9)), throttle(_throttle),
+    quietUntil(0), lastHash(0), suppressed(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool LogSite::Allow(uint64_t _hash, uint32_t &_suppressed)
+{
+  int64_t now = MonotonicNs();
+  bool repeated = this->throttle || (_hash == this->lastHash.load());
+  if (repeated && now < this->quietUntil.load())
+  {
+    this->suppressed.fetch_add(1);
+    return false;
+  }
+
+  this->lastHash.store(_hash);
+  this->quietUntil.store(now + this->interval);
+  _suppressed = this->suppressed.exchange(0);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AsyncLog &AsyncLog::Instance()
+{
+  static AsyncLog log;
+  return log;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AsyncLog::AsyncLog()
+  : queue(Capacity), dropped(0), running(true), sleeping(false)
+{
+  this->thread = boost::thread(boost::bind(&AsyncLog::Run, this));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AsyncLog::~AsyncLog()
+{
+  {
+    boost::mutex::scoped_lock lock(this->wakeMutex);
+    this->running.store(false);
+  }
+  this->wakeCondition.notify_one();
+  this->thread.join();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AsyncLog::Write(LogSite &_site, const char *_format, ...)
+{
+  LogRecord record;
+  va_list args;
+  va_start(args, _format);
+  vsnprintf(record.text, sizeof(record.text), _format, args);
+  va_end(args);
+
+  uint64_t hash = HashBytes(14695981039346656037ULL, record.text,
+                            strlen(record.text));
+  if (!_site.Allow(hash, record.suppressed))
+    return;
+
+  record.site = &_site;
+  Instance().Push(record);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AsyncLog::Push(const LogRecord &_record)
+{
+  if (!this->queue.bounded_push(_record))
+  {
+    this->dropped.fetch_add(1);
+    return;
+  }
+
+  // the writer sets sleeping before it checks the queue a last time, so
+  // either it sees this record or this sees it sleeping
+  if (this->sleeping.load())
+  {
+    boost::mutex::scoped_lock lock(this->wakeMutex);
+    this->wakeCondition.notify_one();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AsyncLog::Run()
+{
+  LogRecord record;
+  while (true)
+  {
+    while (this->queue.pop(record))
+      this->Output(record);
+
+    uint32_t dropped = this->dropped.exchange(0);
+    if (dropped > 0)
+      ROS_WARN("%u log messages dropped, log queue full.", dropped);
+
+    boost::mutex::scoped_lock lock(this->wakeMutex);
+    if (!this->running.load())
+      break;
+
+    this->sleeping.store(true);
+    if (this->queue.empty())
+      this->wakeCondition.wait(lock);
+    this->sleeping.store(false);
+  }
+
+  // messages queued during shutdown
+  while (this->queue.pop(record))
+    this->Output(record);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AsyncLog::Output(const LogRecord &_record)
+{
+  char note[LogRecord::TextSize] = "";
+  if (_record.suppressed > 0)
+  {
+    snprintf(note, sizeof(note), " (%u similar messages suppressed at %s:%d)",
+             _record.suppressed, _record.site->file, _record.site->line);
+  }
+
+  switch (_record.site->level)
+  {
+    case LL_DEBUG:
+      ROS_DEBUG("%s%s", _record.text, note);
+      break;
+    case LL_INFO:
+      ROS_INFO("%s%s", _record.text, note);
+      break;
+    case LL_WARN:
+      ROS_WARN("%s%s", _record.text, note);
+      break;
+    case LL_ERROR:
+      ROS_ERROR("%s%s", _record.text, note);
+      break;
+  }
+}
+}
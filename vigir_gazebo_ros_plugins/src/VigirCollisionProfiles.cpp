@@ -0,0 +1,248 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <vigir_gazebo_ros_plugins/VigirCollisionProfiles.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+CollisionProfiles::CollisionProfiles()
+  : active(NoProfile)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CollisionProfiles::Clear()
+{
+  this->collisions.clear();
+  this->current.clear();
+  this->initial.clear();
+  this->links.clear();
+  this->models.clear();
+  this->names.clear();
+  this->profiles.clear();
+  this->active = NoProfile;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CollisionProfiles::AddModel(const physics::ModelPtr &_model)
+{
+  if (!_model || this->models.count(_model.get()))
+    return;
+
+  size_t modelBegin = this->collisions.size();
+  physics::Link_V modelLinks = _model->GetLinks();
+  for (unsigned int i = 0; i < modelLinks.size(); ++i)
+  {
+    size_t linkBegin = this->collisions.size();
+    physics::Collision_V linkCollisions = modelLinks[i]->GetCollisions();
+    for (unsigned int j = 0; j < linkCollisions.size(); ++j)
+    {
+      Bits bits;
+      bits.category = linkCollisions[j]->GetCategoryBits();
+      bits.collide = linkCollisions[j]->GetCollideBits();
+      this->collisions.push_back(linkCollisions[j]);
+      this->current.push_back(bits);
+      this->initial.push_back(bits);
+    }
+    this->links[modelLinks[i].get()] =
+      std::make_pair(linkBegin, this->collisions.size());
+  }
+  this->models[_model.get()] =
+    std::make_pair(modelBegin, this->collisions.size());
+
+  // profiles defined earlier leave the new collisions as they are
+  for (size_t p = 0; p < this->profiles.size(); ++p)
+  {
+    this->profiles[p].insert(this->profiles[p].end(),
+                             this->initial.begin() + modelBegin,
+                             this->initial.end());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CollisionProfiles::Id CollisionProfiles::Define(const std::string &_name)
+{
+  Id id = this->Find(_name);
+  if (id == NoProfile)
+  {
+    id = static_cast<Id>(this->names.size());
+    this->names.push_back(_name);
+    this->profiles.push_back(std::vector<Bits>());
+  }
+  this->profiles[id] = this->initial;
+  return id;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CollisionProfiles::Id CollisionProfiles::Find(const std::string &_name) const
+{
+  for (size_t i = 0; i < this->names.size(); ++i)
+  {
+    if (this->names[i] == _name)
+      return static_cast<Id>(i);
+  }
+  return NoProfile;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string CollisionProfiles::Name(Id _id) const
+{
+  if (_id < 0 || _id >= static_cast<Id>(this->names.size()))
+    return std::string();
+  return this->names[_id];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CollisionProfiles::SetLink(Id _id, const physics::LinkPtr &_link,
+                                unsigned int _category, unsigned int _collide)
+{
+  size_t begin, end;
+  if (_id < 0 || _id >= static_cast<Id>(this->profiles.size()) ||
+      !this->LinkRange(_link, begin, end))
+    return;
+
+  for (size_t i = begin; i < end; ++i)
+  {
+    this->profiles[_id][i].category = _category;
+    this->profiles[_id][i].collide = _collide;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CollisionProfiles::SetModel(Id _id, const physics::ModelPtr &_model,
+                                 unsigned int _category, unsigned int _ignore)
+{
+  if (_id < 0 || _id >= static_cast<Id>(this->profiles.size()) || !_model)
+    return;
+
+  std::map<physics::Model *, std::pair<size_t, size_t> >::const_iterator it =
+    this->models.find(_model.get());
+  if (it == this->models.end())
+    return;
+
+  for (size_t i = it->second.first; i < it->second.second; ++i)
+  {
+    this->profiles[_id][i].category = _category;
+    this->profiles[_id][i].collide &= ~_ignore;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CollisionProfiles::Apply(Id _id)
+{
+  if (_id < 0 || _id >= static_cast<Id>(this->profiles.size()))
+    return;
+
+  // only collisions that differ between the two profiles are written, so
+  // links overridden with OverrideLink stay as they are otherwise
+  const std::vector<Bits> &bits = this->profiles[_id];
+  const std::vector<Bits> &previous = this->active == NoProfile ?
+    this->current : this->profiles[this->active];
+  for (size_t i = 0; i < bits.size(); ++i)
+  {
+    if (bits[i].category != previous[i].category ||
+        bits[i].collide != previous[i].collide)
+      this->Write(i, bits[i]);
+  }
+  this->active = _id;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CollisionProfiles::Id CollisionProfiles::Active() const
+{
+  return this->active;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CollisionProfiles::OverrideLink(const physics::LinkPtr &_link,
+                                     unsigned int _category,
+                                     unsigned int _collide)
+{
+  size_t begin, end;
+  if (!this->LinkRange(_link, begin, end))
+  {
+    // not a profiled link, nothing to restore later
+    physics::Collision_V linkCollisions = _link->GetCollisions();
+    for (unsigned int i = 0; i < linkCollisions.size(); ++i)
+    {
+      linkCollisions[i]->SetCategoryBits(_category);
+      linkCollisions[i]->SetCollideBits(_collide);
+    }
+    return;
+  }
+
+  Bits bits;
+  bits.category = _category;
+  bits.collide = _collide;
+  for (size_t i = begin; i < end; ++i)
+    this->Write(i, bits);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CollisionProfiles::RestoreLink(const physics::LinkPtr &_link)
+{
+  size_t begin, end;
+  if (!this->LinkRange(_link, begin, end))
+  {
+    this->OverrideLink(_link, AllBits, AllBits);
+    return;
+  }
+
+  const std::vector<Bits> &bits = this->active == NoProfile ?
+    this->initial : this->profiles[this->active];
+  for (size_t i = begin; i < end; ++i)
+    this->Write(i, bits[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CollisionProfiles::Write(size_t _index, const Bits &_bits)
+{
+  Bits &current = this->current[_index];
+  if (current.category != _bits.category)
+  {
+    this->collisions[_index]->SetCategoryBits(_bits.category);
+    current.category = _bits.category;
+  }
+  if (current.collide != _bits.collide)
+  {
+    this->collisions[_index]->SetCollideBits(_bits.collide);
+    current.collide = _bits.collide;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CollisionProfiles::LinkRange(const physics::LinkPtr &_link,
+                                  size_t &_begin, size_t &_end) const
+{
+  if (!_link)
+    return false;
+
+  std::map<physics::Link *, std::pair<size_t, size_t> >::const_iterator it =
+    this->links.find(_link.get());
+  if (it == this->links.end())
+    return false;
+
+  _begin = it->second.first;
+  _end = it->second.second;
+  return true;
+}
+}
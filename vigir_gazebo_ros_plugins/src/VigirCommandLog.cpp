@@ -0,0 +1,219 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/weak_ptr.hpp>
+
+#include <gazebo/common/Console.hh>
+#include <vigir_gazebo_ros_plugins/VigirCommandLog.h>
+
+namespace gazebo
+{
+/// \brief Magic at the start of every command log.
+static const char CommandLogMagic[8] =
+  {'V', 'G', 'C', 'M', 'D', 'L', 'G', '1'};
+
+/// \brief Size of the stdio buffer of a log file in bytes.
+static const size_t CommandLogBufferSize = 1 << 20;
+
+/// \brief Size of a record header in bytes.
+static const size_t CommandRecordHeaderSize = 8 + 4 + 4 + 1 + 1 + 4;
+
+////////////////////////////////////////////////////////////////////////////////
+// Append a plain value to a byte buffer.
+template<class T>
+static void AppendValue(std::vector<uint8_t> &_buffer, const T &_value)
+{
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&_value);
+  _buffer.insert(_buffer.end(), bytes, bytes + sizeof(T));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read a plain value from a byte buffer.
+template<class T>
+static T ReadValue(const uint8_t *_data)
+{
+  T value;
+  memcpy(&value, _data, sizeof(T));
+  return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+boost::shared_ptr<CommandLogWriter> CommandLogWriter::Open(
+  const std::string &_path)
+{
+  static boost::mutex openMutex;
+  static std::map<std::string, boost::weak_ptr<CommandLogWriter> > writers;
+
+  boost::mutex::scoped_lock lock(openMutex);
+  boost::shared_ptr<CommandLogWriter> writer = writers[_path].lock();
+  if (writer)
+    return writer;
+
+  // every session starts its own log, the ticks of a second session would
+  // start over from 0 and break the tick order replay relies on
+  FILE *file = fopen(_path.c_str(), "wb");
+  if (!file)
+  {
+    gzerr << "Unable to open command log [" << _path << "] for writing\n";
+    return writer;
+  }
+
+  writer.reset(new CommandLogWriter(file));
+  fwrite(CommandLogMagic, 1, sizeof(CommandLogMagic), file);
+  writers[_path] = writer;
+  return writer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CommandLogWriter::CommandLogWriter(FILE *_file)
+  : file(_file), fileBuffer(CommandLogBufferSize)
+{
+  setvbuf(this->file, &this->fileBuffer[0], _IOFBF, this->fileBuffer.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CommandLogWriter::~CommandLogWriter()
+{
+  fclose(this->file);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CommandLogWriter::WriteRecord(uint64_t _tick, const common::Time &_time,
+                                   uint8_t _source, uint8_t _type)
+{
+  this->record.clear();
+  AppendValue(this->record, _tick);
+  AppendValue(this->record, static_cast<int32_t>(_time.sec));
+  AppendValue(this->record, static_cast<int32_t>(_time.nsec));
+  AppendValue(this->record, _source);
+  AppendValue(this->record, _type);
+  AppendValue(this->record, static_cast<uint32_t>(this->payload.size()));
+  this->record.insert(this->record.end(), this->payload.begin(),
+                      this->payload.end());
+
+  // one fwrite per record keeps records whole when several plugins share
+  // the file, the stdio buffer is only written out when it is full
+  fwrite(&this->record[0], 1, this->record.size(), this->file);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CommandLogReader::CommandLogReader()
+  : next(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CommandLogReader::Load(const std::string &_path, uint8_t _source)
+{
+  this->records.clear();
+  this->next = 0;
+
+  FILE *file = fopen(_path.c_str(), "rb");
+  if (!file)
+  {
+    gzerr << "Unable to open command log [" << _path << "] for reading\n";
+    return false;
+  }
+
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    data.insert(data.end(), chunk, chunk + n);
+  fclose(file);
+
+  if (data.size() < sizeof(CommandLogMagic) ||
+      memcmp(&data[0], CommandLogMagic, sizeof(CommandLogMagic)) != 0)
+  {
+    gzerr << "[" << _path << "] is not a command log\n";
+    return false;
+  }
+
+  size_t offset = sizeof(CommandLogMagic);
+  while (offset + CommandRecordHeaderSize <= data.size())
+  {
+    const uint8_t *header = &data[offset];
+    uint32_t length = ReadValue<uint32_t>(header + 18);
+    if (offset + CommandRecordHeaderSize + length > data.size())
+    {
+      gzwarn << "Command log [" << _path << "] ends with a truncated record, "
+             << "ignoring it\n";
+      break;
+    }
+
+    if (header[16] == _source)
+    {
+      CommandRecord rec;
+      rec.tick = ReadValue<uint64_t>(header);
+      rec.time = common::Time(ReadValue<int32_t>(header + 8),
+                              ReadValue<int32_t>(header + 12));
+      rec.source = header[16];
+      rec.type = header[17];
+      rec.payload.assign(header + CommandRecordHeaderSize,
+                         header + CommandRecordHeaderSize + length);
+      this->records.push_back(rec);
+    }
+    offset += CommandRecordHeaderSize + length;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CommandLogReader::Next(uint64_t _tick, CommandRecord &_record)
+{
+  if (this->next >= this->records.size() ||
+      this->records[this->next].tick > _tick)
+    return false;
+
+  _record = this->records[this->next++];
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CommandLogReader::Done() const
+{
+  return this->next >= this->records.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t CommandLogReader::Size() const
+{
+  return this->records.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string GetCommandLogPath(sdf::ElementPtr _sdf,
+                              const std::string &_element,
+                              const char *_envVar)
+{
+  char *env = getenv(_envVar);
+  if (env && std::string(env) != "")
+    return std::string(env);
+
+  if (_sdf && _sdf->HasElement(_element))
+    return _sdf->Get<std::string>(_element);
+
+  return std::string();
+}
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <vector>
+
+#include <gazebo/math/Helpers.hh>
+#include <vigir_gazebo_ros_plugins/VigirFingerController.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+FingerController::FingerController()
+  : actuation(PidActuation), motorsEnabled(false), enabled(false)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FingerController::Init(const physics::Joint_V &_joints,
+                            Actuation _actuation)
+{
+  this->joints = _joints;
+  this->actuation = _actuation;
+  this->motorsEnabled = false;
+  this->enabled = false;
+  this->pids.resize(this->joints.size());
+  this->efforts.assign(this->joints.size(), 0.0);
+  this->errors.assign(this->joints.size(), 0.0);
+  for (unsigned int i = 0; i < this->joints.size(); ++i)
+    this->pids[i].Init(1.0, 0, 0.5, 0.0, 0.0, 60.0, -60.0);
+  this->SetEffortLimits(0.0, 0.0);
+
+  // the motor efforts are read from the joint wrenches
+  if (this->actuation == MotorActuation)
+  {
+    for (unsigned int i = 0; i < this->joints.size(); ++i)
+      this->joints[i]->SetProvideFeedback(true);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FingerController::Actuation FingerController::GetActuation() const
+{
+  return this->actuation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FingerController::SetGains(unsigned int _index, double _kp, double _ki,
+                                double _kd)
+{
+  this->pids[_index].SetPGain(_kp);
+  this->pids[_index].SetIGain(_ki);
+  this->pids[_index].SetDGain(_kd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FingerController::SetEffortLimits(double _min, double _max)
+{
+  for (unsigned int i = 0; i < this->joints.size(); ++i)
+  {
+    double limit = this->joints[i]->GetEffortLimit(0);
+    this->pids[i].SetCmdMin(_min < 0 ? _min : -limit);
+    this->pids[i].SetCmdMax(_max > 0 ? _max : limit);
+
+    // the motors are limited to the PID effort
+    if (this->motorsEnabled)
+      this->joints[i]->SetParam("fmax", 0, this->pids[i].GetCmdMax());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FingerController::Reset()
+{
+  for (unsigned int i = 0; i < this->joints.size(); ++i)
+  {
+    this->pids[i].Reset();
+    this->efforts[i] = 0.0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FingerController::Update(const double *_angles, const double *_targets,
+                              const double *_speeds, double _dt)
+{
+  this->enabled = true;
+  if (this->actuation == MotorActuation)
+    this->SetMotorsEnabled(true);
+
+  for (unsigned int i = 0; i < this->joints.size(); ++i)
+  {
+    // Position error.
+    double poseError = _angles[i] - _targets[i];
+    this->errors[i] = poseError;
+
+    if (this->actuation == MotorActuation)
+    {
+      // Reach the target within one update, at most at the target speed.
+      // The engine solves the motor implicitly, so this stays stable
+      // where a stiff PID force wouldn't.
+      double velocity = math::clamp(-poseError / _dt, -_speeds[i],
+                                    _speeds[i]);
+      this->joints[i]->SetParam("vel", 0, velocity);
+      continue;
+    }
+
+    // Update the PID and apply its command.
+    this->efforts[i] = this->pids[i].Update(poseError, _dt);
+    this->joints[i]->SetForce(0, this->efforts[i]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FingerController::Hold()
+{
+  // The joint motors keep their velocity between updates, and the forces
+  // are zero while disabled.
+  if (this->actuation == MotorActuation || !this->enabled)
+    return;
+
+  for (unsigned int i = 0; i < this->joints.size(); ++i)
+    this->joints[i]->SetForce(0, this->efforts[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FingerController::Disable()
+{
+  this->enabled = false;
+  if (this->actuation == MotorActuation)
+  {
+    this->SetMotorsEnabled(false);
+    return;
+  }
+
+  for (unsigned int i = 0; i < this->joints.size(); ++i)
+  {
+    this->efforts[i] = 0.0;
+    this->joints[i]->SetForce(0, 0.0);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double FingerController::GetEffort(unsigned int _index) const
+{
+  if (this->actuation != MotorActuation)
+    return this->efforts[_index];
+
+  // the wrench is in the child link frame
+  const physics::JointPtr &joint = this->joints[_index];
+  math::Vector3 axis = joint->GetChild()->GetWorldPose().rot.GetInverse().
+    RotateVector(joint->GetGlobalAxis(0));
+  return axis.Dot(joint->GetForceTorque(0u).body2Torque);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double FingerController::GetError(unsigned int _index) const
+{
+  return this->errors[_index];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const common::PID &FingerController::GetPID(unsigned int _index) const
+{
+  return this->pids[_index];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FingerController::SetMotorsEnabled(bool _enabled)
+{
+  if (_enabled == this->motorsEnabled)
+    return;
+
+  // The motor force limit is the PID effort limit, a zero limit turns the
+  // motor off.
+  for (unsigned int i = 0; i < this->joints.size(); ++i)
+  {
+    double maxForce = _enabled ? this->pids[i].GetCmdMax() : 0.0;
+    this->joints[i]->SetParam("vel", 0, 0.0);
+    this->joints[i]->SetParam("fmax", 0, maxForce);
+  }
+  this->motorsEnabled = _enabled;
+}
+}
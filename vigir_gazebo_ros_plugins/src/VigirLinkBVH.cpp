@@ -0,0 +1,260 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <vigir_gazebo_ros_plugins/VigirLinkBVH.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+// Orders link indices by the box center along one axis.
+struct CenterLess
+{
+  CenterLess(const std::vector<math::Vector3> &_centers, int _axis)
+    : centers(_centers), axis(_axis) {}
+
+  double Get(int _i) const
+  {
+    const math::Vector3 &c = this->centers[_i];
+    return this->axis == 0 ? c.x : (this->axis == 1 ? c.y : c.z);
+  }
+
+  bool operator()(int _a, int _b) const
+  {
+    return this->Get(_a) < this->Get(_b);
+  }
+
+  const std::vector<math::Vector3> &centers;
+  int axis;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+LinkBVH::LinkBVH()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LinkBVH::Build(const physics::Link_V &_links)
+{
+  this->Clear();
+  this->links.assign(_links.begin(), _links.end());
+  if (this->links.empty())
+    return;
+
+  this->linkBounds.resize(this->links.size());
+  this->centers.resize(this->links.size());
+  this->order.resize(this->links.size());
+  for (size_t i = 0; i < this->links.size(); ++i)
+  {
+    this->linkBounds[i] = LinkBounds(_links[i]);
+    this->centers[i] = (this->linkBounds[i].min + this->linkBounds[i].max) *
+      0.5;
+    this->order[i] = static_cast<int>(i);
+  }
+
+  this->nodes.reserve(2 * this->links.size() - 1);
+  this->BuildNode(0, this->order.size());
+
+  // only needed while building
+  this->linkBounds.clear();
+  this->centers.clear();
+  this->order.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int LinkBVH::BuildNode(size_t _begin, size_t _end)
+{
+  int index = static_cast<int>(this->nodes.size());
+  this->nodes.push_back(Node());
+
+  if (_end - _begin == 1)
+  {
+    Node &leaf = this->nodes[index];
+    leaf.link = this->order[_begin];
+    leaf.left = -1;
+    leaf.right = -1;
+    leaf.bounds = this->linkBounds[leaf.link];
+    return index;
+  }
+
+  // split at the median box center along the widest axis
+  math::Vector3 lo(std::numeric_limits<double>::max(),
+                   std::numeric_limits<double>::max(),
+                   std::numeric_limits<double>::max());
+  math::Vector3 hi = -lo;
+  for (size_t i = _begin; i < _end; ++i)
+  {
+    const math::Vector3 &c = this->centers[this->order[i]];
+    lo.x = std::min(lo.x, c.x);
+    lo.y = std::min(lo.y, c.y);
+    lo.z = std::min(lo.z, c.z);
+    hi.x = std::max(hi.x, c.x);
+    hi.y = std::max(hi.y, c.y);
+    hi.z = std::max(hi.z, c.z);
+  }
+  math::Vector3 extent = hi - lo;
+  int axis = 0;
+  if (extent.y > extent.x)
+    axis = 1;
+  if (extent.z > (axis == 0 ? extent.x : extent.y))
+    axis = 2;
+
+  size_t mid = _begin + (_end - _begin) / 2;
+  std::nth_element(this->order.begin() + _begin, this->order.begin() + mid,
+                   this->order.begin() + _end, CenterLess(this->centers, axis));
+
+  int left = this->BuildNode(_begin, mid);
+  int right = this->BuildNode(mid, _end);
+
+  // nodes may have been reallocated by the recursion
+  Node &node = this->nodes[index];
+  node.link = -1;
+  node.left = left;
+  node.right = right;
+  const Bounds &l = this->nodes[left].bounds;
+  const Bounds &r = this->nodes[right].bounds;
+  node.bounds.min = math::Vector3(std::min(l.min.x, r.min.x),
+                                  std::min(l.min.y, r.min.y),
+                                  std::min(l.min.z, r.min.z));
+  node.bounds.max = math::Vector3(std::max(l.max.x, r.max.x),
+                                  std::max(l.max.y, r.max.y),
+                                  std::max(l.max.z, r.max.z));
+  return index;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LinkBVH::Refit()
+{
+  for (size_t i = this->nodes.size(); i-- > 0;)
+  {
+    Node &node = this->nodes[i];
+    if (node.link >= 0)
+    {
+      node.bounds = LinkBounds(this->links[node.link].lock());
+    }
+    else
+    {
+      const Bounds &l = this->nodes[node.left].bounds;
+      const Bounds &r = this->nodes[node.right].bounds;
+      node.bounds.min = math::Vector3(std::min(l.min.x, r.min.x),
+                                      std::min(l.min.y, r.min.y),
+                                      std::min(l.min.z, r.min.z));
+      node.bounds.max = math::Vector3(std::max(l.max.x, r.max.x),
+                                      std::max(l.max.y, r.max.y),
+                                      std::max(l.max.z, r.max.z));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LinkBVH::Clear()
+{
+  this->links.clear();
+  this->nodes.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t LinkBVH::Size() const
+{
+  return this->links.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+physics::LinkPtr LinkBVH::Nearest(const math::Vector3 &_point,
+                                  double _maxDistance,
+                                  const Filter &_filter) const
+{
+  physics::LinkPtr best;
+  if (this->nodes.empty())
+    return best;
+
+  double bestDist = _maxDistance * _maxDistance;
+  std::vector<int> stack;
+  stack.reserve(64);
+  stack.push_back(0);
+  while (!stack.empty())
+  {
+    const Node &node = this->nodes[stack.back()];
+    stack.pop_back();
+
+    if (SquaredDistance(_point, node.bounds) > bestDist)
+      continue;
+
+    if (node.link >= 0)
+    {
+      physics::LinkPtr link = this->links[node.link].lock();
+      if (link && (_filter.empty() || _filter(link)))
+      {
+        bestDist = SquaredDistance(_point, node.bounds);
+        best = link;
+      }
+      continue;
+    }
+
+    // visit the closer child first, it tightens bestDist sooner
+    double dl = SquaredDistance(_point, this->nodes[node.left].bounds);
+    double dr = SquaredDistance(_point, this->nodes[node.right].bounds);
+    if (dl < dr)
+    {
+      stack.push_back(node.right);
+      stack.push_back(node.left);
+    }
+    else
+    {
+      stack.push_back(node.left);
+      stack.push_back(node.right);
+    }
+  }
+
+  return best;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+LinkBVH::Bounds LinkBVH::LinkBounds(const physics::LinkPtr &_link)
+{
+  Bounds bounds;
+  if (!_link)
+  {
+    bounds.min = math::Vector3(std::numeric_limits<double>::max(),
+                               std::numeric_limits<double>::max(),
+                               std::numeric_limits<double>::max());
+    bounds.max = -bounds.min;
+    return bounds;
+  }
+
+  math::Box box = _link->GetCollisionBoundingBox();
+  bounds.min = box.min;
+  bounds.max = box.max;
+  return bounds;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double LinkBVH::SquaredDistance(const math::Vector3 &_point,
+                                const Bounds &_bounds)
+{
+  double dx = std::max(std::max(_bounds.min.x - _point.x, 0.0),
+                       _point.x - _bounds.max.x);
+  double dy = std::max(std::max(_bounds.min.y - _point.y, 0.0),
+                       _point.y - _bounds.max.y);
+  double dz = std::max(std::max(_bounds.min.z - _point.z, 0.0),
+                       _point.z - _bounds.max.z);
+  return dx * dx + dy * dy + dz * dz;
+}
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gazebo/common/Console.hh>
+#include <sdf/sdf.hh>
+#include <vigir_gazebo_ros_plugins/VigirModelCache.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+bool ModelCache::ToSDF(const std::string &_description, std::string &_sdf)
+{
+  // the converter is part of the key, a different sdformat misses the cache
+  std::string dir = Directory();
+  std::string path;
+  if (!dir.empty())
+  {
+    std::ostringstream name;
+    name << dir << "/" << std::hex
+         << Hash(ConverterId() + "\n" + _description) << ".sdf";
+    path = name.str();
+
+    std::ifstream cached(path.c_str());
+    if (cached)
+    {
+      std::stringstream contents;
+      contents << cached.rdbuf();
+      _sdf = contents.str();
+      if (!_sdf.empty())
+      {
+        // the modification time orders the entries for Prune
+        utime(path.c_str(), NULL);
+        gzmsg << "ModelCache: using [" << path << "]\n";
+        return true;
+      }
+    }
+  }
+
+  sdf::SDFPtr converted(new sdf::SDF());
+  if (!sdf::init(converted) || !sdf::readString(_description, converted))
+  {
+    gzerr << "ModelCache: couldn't convert the model description to SDF.\n";
+    return false;
+  }
+  _sdf = converted->ToString();
+
+  if (path.empty() || !MakeDirectories(dir))
+    return true;
+
+  // rename is atomic, readers see the whole file or none
+  std::ostringstream tmpPath;
+  tmpPath << path << ".tmp." << getpid();
+  {
+    std::ofstream tmp(tmpPath.str().c_str());
+    tmp << _sdf;
+    if (!tmp)
+    {
+      gzwarn << "ModelCache: couldn't write [" << tmpPath.str() << "]\n";
+      unlink(tmpPath.str().c_str());
+      return true;
+    }
+  }
+  if (rename(tmpPath.str().c_str(), path.c_str()) != 0)
+  {
+    unlink(tmpPath.str().c_str());
+    return true;
+  }
+  gzmsg << "ModelCache: stored [" << path << "]\n";
+
+  Prune(dir);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string ModelCache::Directory()
+{
+  const char *env = getenv("VIGIR_MODEL_CACHE");
+  if (env && std::string(env) != "")
+  {
+    if (std::string(env) == "off")
+      return std::string();
+    return std::string(env);
+  }
+
+  const char *home = getenv("HOME");
+  if (!home || std::string(home) == "")
+    return std::string();
+  return std::string(home) + "/.gazebo/vigir_model_cache";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t ModelCache::Hash(const std::string &_data)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < _data.size(); ++i)
+  {
+    hash ^= static_cast<unsigned char>(_data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string ModelCache::ConverterId()
+{
+  std::ostringstream id;
+  id << SDF_VERSION_FULL << " " << SDF_VERSION;
+
+  // the compile time version doesn't change when the library is replaced
+  // under a built plugin
+  bool (*convert)(const std::string &, sdf::SDFPtr) = &sdf::readString;
+  Dl_info info;
+  struct stat st;
+  if (dladdr(reinterpret_cast<void *>(convert), &info) && info.dli_fname &&
+      stat(info.dli_fname, &st) == 0)
+  {
+    id << " " << info.dli_fname << " " << st.st_size << " " << st.st_mtime;
+  }
+  return id.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ModelCache::Prune(const std::string &_dir)
+{
+  DIR *dir = opendir(_dir.c_str());
+  if (!dir)
+    return;
+
+  // entries with their modification time, the oldest are deleted
+  std::vector<std::pair<time_t, std::string> > entries;
+  time_t now = time(NULL);
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL)
+  {
+    std::string name = ent->d_name;
+    std::string path = _dir + "/" + name;
+    struct stat st;
+    if (name[0] == '.' || stat(path.c_str(), &st) != 0 ||
+        !S_ISREG(st.st_mode))
+      continue;
+
+    if (name.find(".tmp.") != std::string::npos)
+    {
+      // a launch still writing it is done within the hour
+      if (now - st.st_mtime > 3600)
+        unlink(path.c_str());
+    }
+    else if (name.size() > 4 && name.substr(name.size() - 4) == ".sdf")
+      entries.push_back(std::make_pair(st.st_mtime, path));
+  }
+  closedir(dir);
+
+  if (entries.size() <= MaxEntries)
+    return;
+
+  std::sort(entries.begin(), entries.end());
+  for (size_t i = 0; i < entries.size() - MaxEntries; ++i)
+    unlink(entries[i].second.c_str());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ModelCache::MakeDirectories(const std::string &_path)
+{
+  for (size_t pos = _path.find('/', 1); ;
+       pos = _path.find('/', pos + 1))
+  {
+    std::string dir = _path.substr(0, pos);
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+      gzwarn << "ModelCache: couldn't create [" << dir << "]\n";
+      return false;
+    }
+    if (pos == std::string::npos)
+      return true;
+  }
+}
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <stdlib.h>
+
+#include <deque>
+
+#include <vigir_gazebo_ros_plugins/VigirPluginExecutor.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+PluginExecutor &PluginExecutor::Instance()
+{
+  return *Get();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+boost::shared_ptr<PluginExecutor> PluginExecutor::Get()
+{
+  static boost::shared_ptr<PluginExecutor> executor(new PluginExecutor(),
+                                                    &PluginExecutor::Destroy);
+  return executor;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PluginExecutor::Destroy(PluginExecutor *_executor)
+{
+  delete _executor;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+PluginExecutor::PluginExecutor()
+  : threadCount(2), running(true)
+{
+  const char *threadsString = getenv("VIGIR_PLUGIN_EXECUTOR_THREADS");
+  if (threadsString && atoi(threadsString) > 0)
+    this->threadCount = atoi(threadsString);
+
+  for (unsigned int i = 0; i < this->threadCount; ++i)
+    this->threads.create_thread(boost::bind(&PluginExecutor::Run, this));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+PluginExecutor::~PluginExecutor()
+{
+  {
+    boost::mutex::scoped_lock lock(this->mutex);
+    this->running = false;
+  }
+  this->taskCondition.notify_all();
+  this->threads.join_all();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int PluginExecutor::ThreadCount() const
+{
+  return this->threadCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PluginExecutor::Post(const boost::function<void ()> &_task)
+{
+  Task task;
+  task.queue = NULL;
+  task.function = _task;
+  {
+    boost::mutex::scoped_lock lock(this->mutex);
+    this->tasks.push_back(task);
+  }
+  this->taskCondition.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PluginExecutor::Schedule(ExecutorQueue *_queue)
+{
+  {
+    boost::mutex::scoped_lock lock(this->mutex);
+    if (_queue->scheduled || _queue->removed)
+      return;
+
+    _queue->scheduled = true;
+    Task task;
+    task.queue = _queue;
+    this->tasks.push_back(task);
+  }
+  this->taskCondition.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PluginExecutor::Remove(ExecutorQueue *_queue)
+{
+  boost::mutex::scoped_lock lock(this->mutex);
+  _queue->removed = true;
+  for (std::deque<Task>::iterator it = this->tasks.begin();
+       it != this->tasks.end();)
+  {
+    if (it->queue == _queue)
+      it = this->tasks.erase(it);
+    else
+      ++it;
+  }
+
+  // a callback of the queue shutting it down, Run() stops after it
+  if (_queue->running &&
+      _queue->runningThread == boost::this_thread::get_id())
+    return;
+
+  while (_queue->running)
+    this->idleCondition.wait(lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PluginExecutor::Run()
+{
+  while (true)
+  {
+    Task task;
+    {
+      boost::mutex::scoped_lock lock(this->mutex);
+      while (this->running && this->tasks.empty())
+        this->taskCondition.wait(lock);
+      if (this->tasks.empty())
+        return;
+
+      task = this->tasks.front();
+      this->tasks.pop_front();
+      if (task.queue)
+      {
+        task.queue->running = true;
+        task.queue->runningThread = boost::this_thread::get_id();
+      }
+    }
+
+    if (!task.queue)
+    {
+      task.function();
+      continue;
+    }
+
+    // a callback added from here on schedules the queue again below, the
+    // queue is never run by two threads at once
+    task.queue->callAvailable(ros::WallDuration());
+
+    bool more = false;
+    {
+      boost::mutex::scoped_lock lock(this->mutex);
+      ExecutorQueue *queue = task.queue;
+      queue->running = false;
+      queue->runningThread = boost::thread::id();
+      queue->scheduled = false;
+      if (!queue->removed && queue->isEnabled() && !queue->isEmpty())
+      {
+        queue->scheduled = true;
+        this->tasks.push_back(task);
+        more = true;
+      }
+    }
+    this->idleCondition.notify_all();
+    if (more)
+      this->taskCondition.notify_one();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ExecutorQueue::ExecutorQueue()
+  : scheduled(false), running(false), removed(false),
+    executor(PluginExecutor::Get())
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ExecutorQueue::~ExecutorQueue()
+{
+  this->Shutdown();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ExecutorQueue::Shutdown()
+{
+  this->disable();
+  this->executor->Remove(this);
+  this->clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ExecutorQueue::addCallback(const ros::CallbackInterfacePtr &_callback,
+                                uint64_t _ownerId)
+{
+  ros::CallbackQueue::addCallback(_callback, _ownerId);
+  this->executor->Schedule(this);
+}
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <string.h>
+
+#include <vigir_gazebo_ros_plugins/VigirPreserializedMessage.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+JointStateTemplate::JointStateTemplate()
+  : size(0), stampOffset(0), positionOffset(0), velocityOffset(0),
+    effortOffset(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool JointStateTemplate::Init(const sensor_msgs::JointState &_msg)
+{
+  this->size = _msg.name.size();
+  if (_msg.position.size() != this->size ||
+      _msg.velocity.size() != this->size ||
+      _msg.effort.size() != this->size)
+  {
+    this->size = 0;
+    this->prototype.data.clear();
+    return false;
+  }
+
+  uint32_t length = ros::serialization::serializationLength(_msg);
+  this->prototype.data.resize(length);
+  ros::serialization::OStream stream(&this->prototype.data[0], length);
+  ros::serialization::serialize(stream, _msg);
+
+  // header (seq, stamp, frame_id), name, then the arrays, each after its
+  // uint32 length
+  uint32_t arrayLength = sizeof(uint32_t) + this->size * sizeof(double);
+  this->stampOffset = sizeof(uint32_t);
+  this->positionOffset = sizeof(uint32_t) +
+    ros::serialization::serializationLength(_msg.header) +
+    ros::serialization::serializationLength(_msg.name);
+  this->velocityOffset = this->positionOffset + arrayLength;
+  this->effortOffset = this->velocityOffset + arrayLength;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const JointStateTemplate::Message &JointStateTemplate::Prototype() const
+{
+  return this->prototype;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t JointStateTemplate::Size() const
+{
+  return this->size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JointStateTemplate::SetStamp(Message &_msg,
+                                  const ros::Time &_stamp) const
+{
+  if (_msg.data.size() < this->stampOffset + 2 * sizeof(uint32_t))
+    return;
+
+  memcpy(&_msg.data[this->stampOffset], &_stamp.sec, sizeof(uint32_t));
+  memcpy(&_msg.data[this->stampOffset + sizeof(uint32_t)], &_stamp.nsec,
+         sizeof(uint32_t));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JointStateTemplate::SetJoint(Message &_msg, size_t _index,
+                                  double _position, double _velocity,
+                                  double _effort) const
+{
+  size_t offset = _index * sizeof(double);
+  if (_index >= this->size ||
+      _msg.data.size() < this->effortOffset + offset + sizeof(double))
+    return;
+
+  memcpy(&_msg.data[this->positionOffset + offset], &_position,
+         sizeof(double));
+  memcpy(&_msg.data[this->velocityOffset + offset], &_velocity,
+         sizeof(double));
+  memcpy(&_msg.data[this->effortOffset + offset], &_effort, sizeof(double));
+}
+}
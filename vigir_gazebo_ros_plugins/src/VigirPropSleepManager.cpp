@@ -0,0 +1,178 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <vector>
+
+#include <vigir_gazebo_ros_plugins/VigirPropSleepManager.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+PropSleepManager::PropSleepManager()
+  : radius(0.0), linearVelocity(0.01), angularVelocity(0.01), restTime(1.0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PropSleepManager::Clear()
+{
+  this->WakeAll();
+  this->props.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PropSleepManager::AddModel(const physics::ModelPtr &_model)
+{
+  if (!_model || _model->IsStatic())
+    return;
+
+  for (unsigned int i = 0; i < this->props.size(); ++i)
+  {
+    if (this->props[i].model == _model)
+      return;
+  }
+
+  Prop prop;
+  prop.model = _model;
+  prop.links = _model->GetLinks();
+  prop.asleep = false;
+  prop.restStart = -1.0;
+  this->props.push_back(prop);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PropSleepManager::SetRadius(double _radius)
+{
+  this->radius = std::max(_radius, 0.0);
+  if (this->radius <= 0.0)
+    this->WakeAll();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PropSleepManager::SetRest(double _linearVelocity,
+                               double _angularVelocity, double _restTime)
+{
+  this->linearVelocity = _linearVelocity;
+  this->angularVelocity = _angularVelocity;
+  this->restTime = _restTime;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PropSleepManager::Update(const math::Vector3 &_robotPosition,
+                              double _time)
+{
+  if (this->radius <= 0.0)
+    return;
+
+  for (unsigned int i = 0; i < this->props.size(); ++i)
+  {
+    Prop &prop = this->props[i];
+    if (prop.asleep)
+    {
+      // the engine enables a disabled body that an enabled one touches
+      bool touched = false;
+      for (unsigned int j = 0; j < prop.links.size() && !touched; ++j)
+        touched = prop.links[j]->GetEnabled();
+
+      if (touched || Distance(prop.box, _robotPosition) < this->radius)
+      {
+        SetAsleep(prop, false);
+        prop.restStart = -1.0;
+      }
+      continue;
+    }
+
+    if (!this->AtRest(prop))
+    {
+      prop.restStart = -1.0;
+      continue;
+    }
+    if (prop.restStart < 0.0 || _time < prop.restStart)
+    {
+      prop.restStart = _time;
+      continue;
+    }
+    if (_time - prop.restStart < this->restTime)
+      continue;
+
+    // the box only changes while the prop moves, so it's read once here
+    math::Box box = prop.model->GetBoundingBox();
+    if (Distance(box, _robotPosition) < this->radius)
+      continue;
+
+    prop.box = box;
+    SetAsleep(prop, true);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PropSleepManager::WakeAll()
+{
+  for (unsigned int i = 0; i < this->props.size(); ++i)
+  {
+    if (this->props[i].asleep)
+      SetAsleep(this->props[i], false);
+    this->props[i].restStart = -1.0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int PropSleepManager::SleepingCount() const
+{
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < this->props.size(); ++i)
+  {
+    if (this->props[i].asleep)
+      ++count;
+  }
+  return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool PropSleepManager::AtRest(const Prop &_prop) const
+{
+  for (unsigned int i = 0; i < _prop.links.size(); ++i)
+  {
+    if (_prop.links[i]->GetWorldLinearVel().GetLength() >
+        this->linearVelocity ||
+        _prop.links[i]->GetWorldAngularVel().GetLength() >
+        this->angularVelocity)
+      return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double PropSleepManager::Distance(const math::Box &_box,
+                                  const math::Vector3 &_point)
+{
+  math::Vector3 d(
+    std::max(std::max(_box.min.x - _point.x, _point.x - _box.max.x), 0.0),
+    std::max(std::max(_box.min.y - _point.y, _point.y - _box.max.y), 0.0),
+    std::max(std::max(_box.min.z - _point.z, _point.z - _box.max.z), 0.0));
+  return d.GetLength();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PropSleepManager::SetAsleep(Prop &_prop, bool _asleep)
+{
+  for (unsigned int i = 0; i < _prop.links.size(); ++i)
+    _prop.links[i]->SetEnabled(!_asleep);
+  _prop.asleep = _asleep;
+}
+}
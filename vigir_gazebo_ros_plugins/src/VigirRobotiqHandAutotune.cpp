@@ -0,0 +1,696 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+/// \brief Headless gain tuner for the Robotiq hand finger PIDs.
+///
+/// Loads a minimal world holding one Robotiq hand, and runs a step response
+/// of all finger joints at once with each candidate gain set.  The fingers
+/// are driven by the FingerController the hand plugin uses, with the
+/// <control_rate> and <position_effort_min/max> of the hand plugin in the
+/// world, so the efforts are held between controller updates like in the
+/// plugin.  Every physics step size runs in its own gazebo server process.
+/// A gain set is only kept for a joint if the joint settles at all step
+/// sizes, among those the one with the shortest settling time plus
+/// overshoot penalty wins.  The winners are written as <joint_gain>
+/// elements to paste into the hand plugin SDF.
+///
+/// The hand plugin in the world stays idle, it doesn't load without ROS
+/// unless it replays a command log.  Hands with <actuation>motor don't use
+/// the gains and are refused.
+///
+/// Usage:
+///   vigir_robotiq_hand_autotune [-s side] [-d step_sizes] [-p kp_values]
+///                               [-i ki_values] [-k kd_values]
+///                               [-t trial_seconds] [-c trials.csv]
+///                               [-o gains.sdf] world_file
+///
+/// Value lists are comma separated, e.g. -d 0.001,0.002,0.004.
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+#include <vigir_gazebo_ros_plugins/VigirFingerController.h>
+
+/// \brief Finger joints of the hand, without the side prefix, in the
+/// order of VigirRobotiqHandPlugin::FindJoints().
+static const char *JointSuffixes[] =
+{
+  "f2_j0", "f1_j0", "f2_j1", "f1_j1", "f0_j1",
+  "f2_j2", "f2_j3", "f1_j2", "f1_j3", "f0_j2", "f0_j3"
+};
+
+/// \brief Number of finger joints.
+static const int NumJoints =
+  sizeof(JointSuffixes) / sizeof(JointSuffixes[0]);
+
+/// \brief The step goes this far from the lower to the upper joint limit.
+static const double StepFraction = 0.6;
+
+/// \brief Step used for joints without usable limits (rad).
+static const double DefaultStep = 0.5;
+
+/// \brief Settled once the error stays within this fraction of the step.
+static const double SettleBand = 0.02;
+
+/// \brief Smallest settle band, matches the plugin pose tolerance (rad).
+static const double MinSettleBand = 0.002;
+
+/// \brief Cost of 100% overshoot, in seconds of settling time.
+static const double OvershootWeight = 1.0;
+
+/// \brief Motor speed passed to the controller, only used by the motor
+/// actuation (rad/s).
+static const double MaxVelocity = 0.88;
+
+/// \brief Header of the trial csv.
+static const char *TrialHeader =
+  "joint,step_size,kp,ki,kd,settle_time,overshoot,stable";
+
+/// \brief One step response.
+struct Trial
+{
+  /// \brief Joint index into JointSuffixes.
+  int joint;
+
+  /// \brief Physics step size.
+  double stepSize;
+
+  /// \brief Gains.
+  double kp;
+  double ki;
+  double kd;
+
+  /// \brief Time until the error stayed within the settle band, the trial
+  /// length if it never did.
+  double settleTime;
+
+  /// \brief Largest excursion past the target, as a fraction of the step.
+  double overshoot;
+
+  /// \brief Settled and ended within the settle band.
+  bool stable;
+};
+
+/// \brief Settings of the hand plugin in the world.
+struct HandSettings
+{
+  /// \brief <control_rate>, 0 updates every physics step.
+  double controlRate;
+
+  /// \brief <position_effort_min>, 0 for the joint effort limit.
+  double effortMin;
+
+  /// \brief <position_effort_max>, 0 for the joint effort limit.
+  double effortMax;
+
+  /// \brief <actuation> is motor.
+  bool motor;
+};
+
+/// \brief Tuner options.
+struct Options
+{
+  /// \brief Hand side, selects the joint name prefix.
+  std::string side;
+
+  /// \brief Physics step sizes to test at.
+  std::vector<double> stepSizes;
+
+  /// \brief Candidate gains, every combination is tried.
+  std::vector<double> kp;
+  std::vector<double> ki;
+  std::vector<double> kd;
+
+  /// \brief Sim time of one step response.
+  double trialSeconds;
+
+  /// \brief Trial results file, empty for none.
+  std::string trials;
+
+  /// \brief Gains file, empty for stdout.
+  std::string output;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Parse a comma separated list of numbers.
+static bool ParseList(const char *_text, std::vector<double> &_values)
+{
+  _values.clear();
+  std::istringstream in(_text);
+  std::string item;
+  while (std::getline(in, item, ','))
+  {
+    char *end;
+    double value = strtod(item.c_str(), &end);
+    if (item.empty() || *end != '\0')
+      return false;
+    _values.push_back(value);
+  }
+  return !_values.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Find a joint in any model of the world.
+static gazebo::physics::JointPtr FindJoint(gazebo::physics::WorldPtr _world,
+                                           const std::string &_name)
+{
+  gazebo::physics::Model_V models = _world->GetModels();
+  for (size_t i = 0; i < models.size(); ++i)
+  {
+    gazebo::physics::JointPtr joint = models[i]->GetJoint(_name);
+    if (joint)
+      return joint;
+  }
+  return gazebo::physics::JointPtr();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read the settings of the hand plugin of one side, the plugin defaults if
+// there is none.
+static void LoadHandSettings(gazebo::physics::WorldPtr _world,
+                             const std::string &_side,
+                             HandSettings &_settings)
+{
+  _settings.controlRate = 0.0;
+  _settings.effortMin = 0.0;
+  _settings.effortMax = 0.0;
+  _settings.motor = false;
+
+  gazebo::physics::Model_V models = _world->GetModels();
+  for (size_t i = 0; i < models.size(); ++i)
+  {
+    sdf::ElementPtr modelSdf = models[i]->GetSDF();
+    if (!modelSdf || !modelSdf->HasElement("plugin"))
+      continue;
+
+    for (sdf::ElementPtr plugin = modelSdf->GetElement("plugin"); plugin;
+         plugin = plugin->GetNextElement("plugin"))
+    {
+      if (!plugin->HasElement("side") ||
+          plugin->Get<std::string>("side") != _side)
+        continue;
+
+      if (plugin->HasElement("control_rate"))
+        _settings.controlRate = plugin->Get<double>("control_rate");
+      if (plugin->HasElement("position_effort_min"))
+        _settings.effortMin = plugin->Get<double>("position_effort_min");
+      if (plugin->HasElement("position_effort_max"))
+        _settings.effortMax = plugin->Get<double>("position_effort_max");
+      if (plugin->HasElement("actuation"))
+        _settings.motor = plugin->Get<std::string>("actuation") == "motor";
+      return;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Run one step response of all joints from the world's initial state, the
+// gains of the first trial are used for every joint.
+static void RunTrial(gazebo::physics::WorldPtr _world,
+                     const gazebo::physics::Joint_V &_joints,
+                     gazebo::FingerController &_control,
+                     const HandSettings &_settings,
+                     const Options &_options, std::vector<Trial> &_trials)
+{
+  _world->Reset();
+  _control.Reset();
+
+  size_t count = _joints.size();
+  std::vector<double> targets(count);
+  std::vector<double> speeds(count, MaxVelocity);
+  std::vector<double> angles(count);
+  std::vector<double> steps(count);
+  std::vector<double> bands(count);
+  std::vector<double> directions(count);
+  std::vector<double> lastOutside(count, 0.0);
+  std::vector<double> overshoots(count, 0.0);
+  std::vector<double> errors(count, 0.0);
+  for (size_t j = 0; j < count; ++j)
+  {
+    const gazebo::physics::JointPtr &joint = _joints[j];
+    _control.SetGains(j, _trials[0].kp, _trials[0].ki, _trials[0].kd);
+
+    double start = joint->GetAngle(0).Radian();
+    double lower = joint->GetLowerLimit(0).Radian();
+    double upper = joint->GetUpperLimit(0).Radian();
+    targets[j] = start + DefaultStep;
+    if (upper > lower && upper - lower < 2 * M_PI)
+      targets[j] = lower + StepFraction * (upper - lower);
+    steps[j] = fabs(targets[j] - start);
+    bands[j] = std::max(SettleBand * steps[j], MinSettleBand);
+    directions[j] = targets[j] >= start ? 1.0 : -1.0;
+  }
+
+  // the plugin updates once the control period passed and holds the
+  // efforts on the steps in between
+  double stepSize = _trials[0].stepSize;
+  unsigned int updateSteps = 1;
+  if (_settings.controlRate > 0)
+  {
+    updateSteps = std::max(1u, static_cast<unsigned int>(
+      ceil(1.0 / (_settings.controlRate * stepSize) - 1e-9)));
+  }
+
+  unsigned int iterations =
+    static_cast<unsigned int>(_options.trialSeconds / stepSize + 0.5);
+  bool finite = true;
+  for (unsigned int i = 0; i < iterations && finite; ++i)
+  {
+    if (i % updateSteps == 0)
+    {
+      for (size_t j = 0; j < count; ++j)
+        angles[j] = _joints[j]->GetAngle(0).Radian();
+      _control.Update(&angles[0], &targets[0], &speeds[0],
+                      updateSteps * stepSize);
+    }
+    else
+      _control.Hold();
+    gazebo::runWorld(_world, 1);
+
+    for (size_t j = 0; j < count; ++j)
+    {
+      double error = _joints[j]->GetAngle(0).Radian() - targets[j];
+      errors[j] = error;
+      finite = finite && error == error && fabs(error) < 1e3;
+      if (fabs(error) > bands[j])
+        lastOutside[j] = (i + 1) * stepSize;
+      if (steps[j] > 0)
+      {
+        overshoots[j] =
+          std::max(overshoots[j], directions[j] * error / steps[j]);
+      }
+    }
+  }
+
+  // one unstable joint can throw the others around, all fail
+  for (size_t j = 0; j < count; ++j)
+  {
+    Trial &trial = _trials[j];
+    trial.settleTime = lastOutside[j];
+    trial.overshoot = overshoots[j];
+    trial.stable = finite && fabs(errors[j]) <= bands[j] &&
+      lastOutside[j] < _options.trialSeconds;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Run every gain set at one step size in this process and return the
+// trials as csv lines.  Only called in a freshly forked child, gazebo can
+// load one server per process.
+static std::string RunStepSize(const std::string &_worldFile,
+                               double _stepSize, const Options &_options)
+{
+  // keep the hand plugin idle
+  unsetenv("VRC_REPLAY_LOG");
+  unsetenv("VRC_COMMAND_LOG");
+
+  if (!gazebo::setupServer())
+    return std::string();
+
+  gazebo::physics::WorldPtr world = gazebo::loadWorld(_worldFile);
+  if (!world)
+  {
+    gazebo::shutdown();
+    return std::string();
+  }
+
+  HandSettings settings;
+  LoadHandSettings(world, _options.side, settings);
+  if (settings.motor)
+  {
+    std::cerr << "The " << _options.side << " hand uses motor actuation, "
+              << "which doesn't use the PID gains.\n";
+    gazebo::shutdown();
+    return std::string();
+  }
+
+  // no real time throttling, step as fast as possible
+  world->GetPhysicsEngine()->SetRealTimeUpdateRate(0.0);
+  world->GetPhysicsEngine()->SetMaxStepSize(_stepSize);
+
+  // every finger is driven in every trial, like by a hand command
+  gazebo::physics::Joint_V joints;
+  std::vector<int> indices;
+  for (int j = 0; j < NumJoints; ++j)
+  {
+    std::string name = _options.side + "_" + JointSuffixes[j];
+    gazebo::physics::JointPtr joint = FindJoint(world, name);
+    if (!joint)
+    {
+      std::cerr << "Joint [" << name << "] not found, skipped.\n";
+      continue;
+    }
+    joints.push_back(joint);
+    indices.push_back(j);
+  }
+  if (joints.empty())
+  {
+    gazebo::shutdown();
+    return std::string();
+  }
+
+  gazebo::FingerController control;
+  control.Init(joints, gazebo::FingerController::PidActuation);
+  control.SetEffortLimits(settings.effortMin, settings.effortMax);
+
+  std::ostringstream out;
+  for (size_t p = 0; p < _options.kp.size(); ++p)
+  {
+    for (size_t i = 0; i < _options.ki.size(); ++i)
+    {
+      for (size_t d = 0; d < _options.kd.size(); ++d)
+      {
+        std::vector<Trial> trials(joints.size());
+        for (size_t j = 0; j < joints.size(); ++j)
+        {
+          trials[j].joint = indices[j];
+          trials[j].stepSize = _stepSize;
+          trials[j].kp = _options.kp[p];
+          trials[j].ki = _options.ki[i];
+          trials[j].kd = _options.kd[d];
+        }
+        RunTrial(world, joints, control, settings, _options, trials);
+
+        for (size_t j = 0; j < trials.size(); ++j)
+        {
+          const Trial &trial = trials[j];
+          out << JointSuffixes[trial.joint] << "," << trial.stepSize << ","
+              << trial.kp << "," << trial.ki << "," << trial.kd << ","
+              << trial.settleTime << "," << trial.overshoot << ","
+              << (trial.stable ? 1 : 0) << "\n";
+        }
+      }
+    }
+  }
+
+  gazebo::shutdown();
+  return out.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read everything a child wrote to its result pipe.
+static std::string ReadAll(int _fd)
+{
+  std::string result;
+  char buffer[4096];
+  ssize_t n;
+  while ((n = read(_fd, buffer, sizeof(buffer))) != 0)
+  {
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    result.append(buffer, n);
+  }
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Parse the trial csv lines of one child.
+static void ParseTrials(const std::string &_text, std::vector<Trial> &_trials)
+{
+  std::istringstream in(_text);
+  std::string line;
+  while (std::getline(in, line))
+  {
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream fields(line);
+    std::string suffix;
+    Trial trial;
+    int stable;
+    if (!(fields >> suffix >> trial.stepSize >> trial.kp >> trial.ki
+                 >> trial.kd >> trial.settleTime >> trial.overshoot
+                 >> stable))
+      continue;
+
+    trial.joint = -1;
+    for (int j = 0; j < NumJoints; ++j)
+    {
+      if (suffix == JointSuffixes[j])
+        trial.joint = j;
+    }
+    trial.stable = stable != 0;
+    if (trial.joint >= 0)
+      _trials.push_back(trial);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void Usage()
+{
+  std::cerr << "Usage: vigir_robotiq_hand_autotune [-s side] [-d step_sizes] "
+            << "[-p kp_values] [-i ki_values] [-k kd_values] "
+            << "[-t trial_seconds] [-c trials.csv] [-o gains.sdf] "
+            << "world_file\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int _argc, char **_argv)
+{
+  Options options;
+  options.side = "right";
+  ParseList("0.001,0.002,0.004", options.stepSizes);
+  ParseList("0.5,1,2,5,10,20", options.kp);
+  ParseList("0", options.ki);
+  ParseList("0,0.05,0.1,0.5,1", options.kd);
+  options.trialSeconds = 2.0;
+
+  int opt;
+  bool ok = true;
+  while ((opt = getopt(_argc, _argv, "s:d:p:i:k:t:c:o:h")) != -1)
+  {
+    switch (opt)
+    {
+      case 's':
+        options.side = optarg;
+        break;
+      case 'd':
+        ok = ok && ParseList(optarg, options.stepSizes);
+        break;
+      case 'p':
+        ok = ok && ParseList(optarg, options.kp);
+        break;
+      case 'i':
+        ok = ok && ParseList(optarg, options.ki);
+        break;
+      case 'k':
+        ok = ok && ParseList(optarg, options.kd);
+        break;
+      case 't':
+        options.trialSeconds = atof(optarg);
+        break;
+      case 'c':
+        options.trials = optarg;
+        break;
+      case 'o':
+        options.output = optarg;
+        break;
+      default:
+        ok = false;
+    }
+  }
+
+  if (!ok || optind != _argc - 1 || options.trialSeconds <= 0 ||
+      (options.side != "left" && options.side != "right"))
+  {
+    Usage();
+    return 1;
+  }
+  std::string worldFile = _argv[optind];
+
+  // one gazebo server per step size, trials come back over a pipe
+  std::map<pid_t, std::pair<size_t, int> > running;
+  bool failed = false;
+  for (size_t s = 0; s < options.stepSizes.size(); ++s)
+  {
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+      perror("pipe");
+      failed = true;
+      break;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+      perror("fork");
+      close(fds[0]);
+      close(fds[1]);
+      failed = true;
+      break;
+    }
+
+    if (pid == 0)
+    {
+      close(fds[0]);
+      std::string result =
+        RunStepSize(worldFile, options.stepSizes[s], options);
+      size_t written = 0;
+      while (written < result.size())
+      {
+        ssize_t n = write(fds[1], result.c_str() + written,
+                          result.size() - written);
+        if (n < 0 && errno != EINTR)
+          _exit(1);
+        if (n > 0)
+          written += n;
+      }
+      close(fds[1]);
+      _exit(0);
+    }
+
+    close(fds[1]);
+    running[pid] = std::make_pair(s, fds[0]);
+    std::cerr << "[step " << options.stepSizes[s] << "] started\n";
+  }
+
+  // drain the pipes before waiting, a child blocks once its pipe is full.
+  // every child is reaped, also after one failed.
+  std::vector<Trial> trials;
+  for (std::map<pid_t, std::pair<size_t, int> >::iterator it =
+       running.begin(); it != running.end(); ++it)
+  {
+    size_t before = trials.size();
+    ParseTrials(ReadAll(it->second.second), trials);
+    close(it->second.second);
+
+    int status;
+    while (waitpid(it->first, &status, 0) < 0 && errno == EINTR)
+      continue;
+    if (trials.size() == before)
+    {
+      std::cerr << "[step " << options.stepSizes[it->second.first]
+                << "] failed\n";
+      failed = true;
+      continue;
+    }
+    std::cerr << "[step " << options.stepSizes[it->second.first]
+              << "] finished\n";
+  }
+  if (failed)
+    return 1;
+
+  if (!options.trials.empty())
+  {
+    std::ofstream file(options.trials.c_str());
+    if (!file)
+    {
+      std::cerr << "Unable to write trials to [" << options.trials << "]\n";
+      return 1;
+    }
+    file << TrialHeader << "\n";
+    for (size_t t = 0; t < trials.size(); ++t)
+    {
+      const Trial &trial = trials[t];
+      file << JointSuffixes[trial.joint] << "," << trial.stepSize << ","
+           << trial.kp << "," << trial.ki << "," << trial.kd << ","
+           << trial.settleTime << "," << trial.overshoot << ","
+           << (trial.stable ? 1 : 0) << "\n";
+    }
+  }
+
+  // worst case over the step sizes of every joint and gain set
+  typedef std::pair<int, std::vector<double> > Key;
+  std::map<Key, std::pair<double, size_t> > cost;
+  std::map<Key, bool> rejected;
+  for (size_t t = 0; t < trials.size(); ++t)
+  {
+    const Trial &trial = trials[t];
+    std::vector<double> gains;
+    gains.push_back(trial.kp);
+    gains.push_back(trial.ki);
+    gains.push_back(trial.kd);
+    Key key(trial.joint, gains);
+
+    if (!trial.stable)
+      rejected[key] = true;
+    double c = trial.settleTime + OvershootWeight * trial.overshoot;
+    std::pair<double, size_t> &worst = cost[key];
+    worst.first = std::max(worst.first, c);
+    ++worst.second;
+  }
+
+  std::vector<double> best[NumJoints];
+  double bestCost[NumJoints];
+  std::fill(bestCost, bestCost + NumJoints,
+            std::numeric_limits<double>::max());
+  for (std::map<Key, std::pair<double, size_t> >::iterator it = cost.begin();
+       it != cost.end(); ++it)
+  {
+    int joint = it->first.first;
+    if (rejected[it->first] || it->second.second != options.stepSizes.size())
+      continue;
+    if (it->second.first < bestCost[joint])
+    {
+      bestCost[joint] = it->second.first;
+      best[joint] = it->first.second;
+    }
+  }
+
+  std::ofstream file;
+  if (!options.output.empty())
+  {
+    file.open(options.output.c_str());
+    if (!file)
+    {
+      std::cerr << "Unable to write gains to [" << options.output << "]\n";
+      return 1;
+    }
+  }
+  std::ostream &out = options.output.empty() ? std::cout : file;
+
+  out << "<!-- vigir_robotiq_hand_autotune, step sizes";
+  for (size_t s = 0; s < options.stepSizes.size(); ++s)
+    out << " " << options.stepSizes[s];
+  out << " -->\n";
+  for (int j = 0; j < NumJoints; ++j)
+  {
+    if (best[j].empty())
+    {
+      std::cerr << "No gains stable at all step sizes for joint ["
+                << JointSuffixes[j] << "], keeping the hand wide gains.\n";
+      continue;
+    }
+    out << "<joint_gain>\n"
+        << "  <joint>" << JointSuffixes[j] << "</joint>\n"
+        << "  <kp>" << best[j][0] << "</kp>\n"
+        << "  <ki>" << best[j][1] << "</ki>\n"
+        << "  <kd>" << best[j][2] << "</kd>\n"
+        << "</joint_gain>\n";
+  }
+
+  return 0;
+}
@@ -39,28 +39,43 @@ const std::string VigirRobotiqHandPlugin::DefaultRightTopicState   =
 ////////////////////////////////////////////////////////////////////////////////
 VigirRobotiqHandPlugin::VigirRobotiqHandPlugin()
 {
-  // PID default parameters.
   for (int i = 0; i < this->NumJoints; ++i)
   {
-    this->posePID[i].Init(1.0, 0, 0.5, 0.0, 0.0, 60.0, -60.0);
-    this->posePID[i].SetCmd(0.0);
+    this->lowerLimits[i] = 0.0;
+    this->upperLimits[i] = 0.0;
+    this->jointSnapshot.angle[i] = 0.0;
+    this->jointSnapshot.velocity[i] = 0.0;
+    this->jointSnapshot.force[i] = 0.0;
+    this->gainOverrides[i].kp = -1.0;
+    this->gainOverrides[i].ki = -1.0;
+    this->gainOverrides[i].kd = -1.0;
   }
 
   // Default grasping mode: Basic mode.
   this->graspingMode = Basic;
 
+  this->commandSource = gazebo::CS_LEFT_HAND;
+
   // Default hand state: Disabled.
   this->handState = Disabled;
+
+  this->velTolerance = 0.002;
+  this->poseTolerance = 0.002;
+  this->jointStatePeriod = 0.0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 VigirRobotiqHandPlugin::~VigirRobotiqHandPlugin()
 {
   gazebo::event::Events::DisconnectWorldUpdateBegin(this->updateConnection);
-  this->rosNode->shutdown();
-  this->rosQueue.clear();
-  this->rosQueue.disable();
-  this->callbackQueueThread.join();
+  this->reconfigureServer.reset();
+  if (!this->snapshotName.empty())
+    gazebo::SnapshotRegistry::Instance().Unregister(this->snapshotName);
+  if (this->rosNode)
+    this->rosNode->shutdown();
+  this->pubHandleState.Shutdown();
+  this->pubJointStates.Shutdown();
+  this->rosQueue.Shutdown();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -71,6 +86,9 @@ void VigirRobotiqHandPlugin::Load(gazebo::physics::ModelPtr _parent,
   this->world = this->model->GetWorld();
   this->sdf = _sdf;
 
+  // start the log writer thread before the first world update
+  gazebo::AsyncLog::Instance();
+
   if (!this->sdf->HasElement("side") ||
       !this->sdf->GetElement("side")->GetValue()->Get(this->side) ||
       ((this->side != "left") && (this->side != "right")))
@@ -92,6 +110,30 @@ void VigirRobotiqHandPlugin::Load(gazebo::physics::ModelPtr _parent,
   if (!this->FindJoints())
     return;
 
+  // Select the actuation backend.
+  gazebo::FingerController::Actuation actuation =
+    gazebo::FingerController::PidActuation;
+  if (this->sdf->HasElement("actuation"))
+  {
+    std::string actuationName = this->sdf->Get<std::string>("actuation");
+    if (actuationName == "motor")
+      actuation = gazebo::FingerController::MotorActuation;
+    else if (actuationName != "pid")
+    {
+      gzerr << "Unknown <actuation> [" << actuationName << "], using pid."
+            << std::endl;
+    }
+  }
+  this->fingerControl.Init(this->fingerJoints, actuation);
+
+  // The limits don't change, read them once.
+  for (int i = 0; i < this->NumJoints; ++i)
+  {
+    this->lowerLimits[i] = this->joints[i]->GetLowerLimit(0).Radian();
+    this->upperLimits[i] = this->joints[i]->GetUpperLimit(0).Radian();
+  }
+  this->ReadJointStates();
+
   // Initialize joint state vector.
   this->jointStates.name.resize(this->jointNames.size());
   this->jointStates.position.resize(this->jointNames.size());
@@ -105,6 +147,9 @@ void VigirRobotiqHandPlugin::Load(gazebo::physics::ModelPtr _parent,
     this->jointStates.effort[i] = 0;
   }
 
+  // Serialized once, also when headless, and patched every update.
+  this->jointStateTemplate.Init(this->jointStates);
+
   // Default ROS topic names.
   std::string controlTopicName = this->DefaultLeftTopicCommand;
   std::string stateTopicName   = this->DefaultLeftTopicState;
@@ -114,32 +159,9 @@ void VigirRobotiqHandPlugin::Load(gazebo::physics::ModelPtr _parent,
     stateTopicName   = this->DefaultRightTopicState;
   }
 
-  for (int i = 0; i < this->NumJoints; ++i)
-  {
-    // Set the PID effort limits.
-    this->posePID[i].SetCmdMin(-this->fingerJoints[i]->GetEffortLimit(0));
-    this->posePID[i].SetCmdMax(this->fingerJoints[i]->GetEffortLimit(0));
-
-    // Overload the PID parameters if they are available.
-    if (this->sdf->HasElement("kp_position"))
-      this->posePID[i].SetPGain(this->sdf->Get<double>("kp_position"));
-
-    if (this->sdf->HasElement("ki_position"))
-      this->posePID[i].SetIGain(this->sdf->Get<double>("ki_position"));
-
-    if (this->sdf->HasElement("kd_position"))
-    {
-      this->posePID[i].SetDGain(this->sdf->Get<double>("kd_position"));
-      std::cout << "dGain after overloading: " << this->posePID[i].GetDGain()
-                << std::endl;
-    }
-
-    if (this->sdf->HasElement("position_effort_min"))
-      this->posePID[i].SetCmdMin(this->sdf->Get<double>("position_effort_min"));
-
-    if (this->sdf->HasElement("position_effort_max"))
-      this->posePID[i].SetCmdMax(this->sdf->Get<double>("position_effort_max"));
-  }
+  // The gains and effort limits come from the tunables and <joint_gain>,
+  // see ApplyConfig().
+  this->LoadJointGains();
 
   // Overload the ROS topics for the hand if they are available.
   if (this->sdf->HasElement("topic_command"))
@@ -148,31 +170,72 @@ void VigirRobotiqHandPlugin::Load(gazebo::physics::ModelPtr _parent,
   if (this->sdf->HasElement("topic_state"))
     stateTopicName = this->sdf->Get<std::string>("topic_state");
 
+  // Command record / replay, shared with VRCPlugin.
+  if (this->side == "right")
+    this->commandSource = gazebo::CS_RIGHT_HAND;
+  std::string commandLogName = gazebo::GetCommandLogPath(this->sdf,
+    "command_log", "VRC_COMMAND_LOG");
+  std::string replayLogName = gazebo::GetCommandLogPath(this->sdf,
+    "replay_log", "VRC_REPLAY_LOG");
+  if (!replayLogName.empty())
+  {
+    this->commandReplay.reset(new gazebo::CommandLogReader());
+    if (!this->commandReplay->Load(replayLogName, this->commandSource))
+      this->commandReplay.reset();
+  }
+  if (!commandLogName.empty())
+    this->commandLog = gazebo::CommandLogWriter::Open(commandLogName);
+
+  // Controller time control.
+  this->lastControllerUpdateTime = this->world->GetSimTime();
+
+  // Saved and restored with VRCPlugin world snapshots.
+  this->snapshotName = this->side + "_hand";
+  gazebo::SnapshotRegistry::Instance().Register(this->snapshotName,
+    boost::bind(&VigirRobotiqHandPlugin::SaveState, this, _1),
+    boost::bind(&VigirRobotiqHandPlugin::RestoreState, this, _1));
+
   // Initialize ROS.
   if (!ros::isInitialized())
   {
-    gzerr << "Not loading plugin since ROS hasn't been "
-          << "properly initialized. Try starting gazebo with ROS plugin:\n"
-          << " gazebo -s libgazebo_ros_api_plugin.so\n";
+    if (!this->commandReplay)
+    {
+      gzerr << "Not loading plugin since ROS hasn't been "
+            << "properly initialized. Try starting gazebo with ROS plugin:\n"
+            << " gazebo -s libgazebo_ros_api_plugin.so\n";
+      return;
+    }
+
+    // Replay the recorded commands without any ROS interface.
+    gzmsg << "VigirRobotiqHandPlugin: ROS not initialized, replaying "
+          << this->side << " hand commands headless." << std::endl;
+    ros::Time::init();
+    this->LoadConfig();
+    this->ApplyConfig();
+    this->updateConnection =
+      gazebo::event::Events::ConnectWorldUpdateBegin(
+        boost::bind(&VigirRobotiqHandPlugin::UpdateStates, this));
     return;
   }
 
   // Create a ROS node.
   this->rosNode.reset(new ros::NodeHandle(""));
 
-  // Publish multi queue.
-  this->pmq.startServiceThread();
+  // Tunables, served on rosQueue by the PluginExecutor.
+  this->LoadConfig();
+  this->ApplyConfig();
 
-  // Broadcasts state.
-  this->pubHandleStateQueue = this->pmq.addPub<atlas_msgs::SModelRobotInput>();
-  this->pubHandleState = this->rosNode->advertise<atlas_msgs::SModelRobotInput>(
-    stateTopicName, 100, true);
+  // Broadcasts state, published from the PluginExecutor.
+  this->pubHandleState.Init(
+    this->rosNode->advertise<atlas_msgs::SModelRobotInput>(
+      stateTopicName, 100, true));
 
-  // Broadcast joint state.
+  // Broadcast joint state from the serialized template.
   std::string topicBase = std::string("robotiq_hands/") + this->side;
-  this->pubJointStatesQueue = this->pmq.addPub<sensor_msgs::JointState>();
-  this->pubJointStates = this->rosNode->advertise<sensor_msgs::JointState>(
-    topicBase + std::string("_hand/joint_states"), 10);
+  this->pubJointStates.Init(
+    this->rosNode->advertise<gazebo::JointStateTemplate::Message>(
+      topicBase + std::string("_hand/joint_states"), 10),
+    this->jointStateTemplate.Prototype());
 
   // Subscribe to user published handle control commands.
   ros::SubscribeOptions handleCommandSo =
@@ -186,13 +249,6 @@ void VigirRobotiqHandPlugin::Load(gazebo::physics::ModelPtr _parent,
     ros::TransportHints().reliable().tcpNoDelay(true);
   this->subHandleCommand = this->rosNode->subscribe(handleCommandSo);
 
-  // Controller time control.
-  this->lastControllerUpdateTime = this->world->GetSimTime();
-
-  // Start callback queue.
-  this->callbackQueueThread =
-    boost::thread(boost::bind(&VigirRobotiqHandPlugin::RosQueueThread, this));
-
   // Connect to gazebo world update.
   this->updateConnection =
     gazebo::event::Events::ConnectWorldUpdateBegin(
@@ -203,15 +259,16 @@ void VigirRobotiqHandPlugin::Load(gazebo::physics::ModelPtr _parent,
         << std::endl;
   for (int i = 0; i < this->NumJoints; ++i)
   {
+    const gazebo::common::PID &pid = this->fingerControl.GetPID(i);
     gzlog << "Position PID parameters for joint ["
           << this->fingerJoints[i]->GetName() << "]:"     << std::endl
-          << "\tKP: "     << this->posePID[i].GetPGain()  << std::endl
-          << "\tKI: "     << this->posePID[i].GetIGain()  << std::endl
-          << "\tKD: "     << this->posePID[i].GetDGain()  << std::endl
-          << "\tIMin: "   << this->posePID[i].GetIMin()   << std::endl
-          << "\tIMax: "   << this->posePID[i].GetIMax()   << std::endl
-          << "\tCmdMin: " << this->posePID[i].GetCmdMin() << std::endl
-          << "\tCmdMax: " << this->posePID[i].GetCmdMax() << std::endl
+          << "\tKP: "     << pid.GetPGain()  << std::endl
+          << "\tKI: "     << pid.GetIGain()  << std::endl
+          << "\tKD: "     << pid.GetDGain()  << std::endl
+          << "\tIMin: "   << pid.GetIMin()   << std::endl
+          << "\tIMax: "   << pid.GetIMax()   << std::endl
+          << "\tCmdMin: " << pid.GetCmdMin() << std::endl
+          << "\tCmdMax: " << pid.GetCmdMax() << std::endl
           << std::endl;
   }
   gzlog << "Topic for sending hand commands: ["   << controlTopicName
@@ -225,8 +282,8 @@ bool VigirRobotiqHandPlugin::VerifyField(const std::string &_label, int _min,
 {
   if (_v < _min || _v > _max)
   {
-    std::cerr << "Illegal " << _label << " value: [" << _v << "]. The correct "
-              << "range is [" << _min << "," << _max << "]" << std::endl;
+    VIGIR_LOG_WARN("Illegal %s value: [%d]. The correct range is [%d,%d]",
+                   _label.c_str(), _v, _min, _max);
     return false;
   }
   return true;
@@ -261,20 +318,101 @@ void VigirRobotiqHandPlugin::SetHandleCommand(
     const atlas_msgs::SModelRobotOutput::ConstPtr &_msg)
 {
   boost::mutex::scoped_lock lock(this->controlMutex);
+  this->pendingCommands.push_back(_msg);
+}
 
+////////////////////////////////////////////////////////////////////////////////
+void VigirRobotiqHandPlugin::ApplyHandleCommand(
+    const atlas_msgs::SModelRobotOutput::ConstPtr &_msg)
+{
   // Sanity check.
   if (!this->VerifyCommand(_msg))
   {
-    std::cerr << "Ignoring command" << std::endl;
+    VIGIR_LOG_WARN("Ignoring command");
     return;
   }
 
+  if (this->commandLog)
+  {
+    this->commandLog->Write(this->world->GetIterations(),
+      this->world->GetSimTime(), this->commandSource, 0, *_msg);
+  }
+
   this->prevCommand = this->handleCommand;
 
   // Update handleCommand.
   this->handleCommand = *_msg;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void VigirRobotiqHandPlugin::ReplayCommands()
+{
+  if (!this->commandReplay)
+    return;
+
+  gazebo::CommandRecord rec;
+  while (this->commandReplay->Next(this->world->GetIterations(), rec))
+  {
+    this->ApplyHandleCommand(gazebo::CommandLogReader::Decode<
+      atlas_msgs::SModelRobotOutput>(rec));
+  }
+
+  if (this->commandReplay->Done())
+    this->commandReplay.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VigirRobotiqHandPlugin::SaveState(std::vector<uint8_t> &_buffer)
+{
+  boost::mutex::scoped_lock lock(this->controlMutex);
+
+  uint32_t length = 2 +
+    ros::serialization::serializationLength(this->handleCommand) +
+    ros::serialization::serializationLength(this->lastHandleCommand) +
+    ros::serialization::serializationLength(this->prevCommand) +
+    ros::serialization::serializationLength(this->userHandleCommand) +
+    ros::serialization::serializationLength(this->handleState);
+  _buffer.resize(length);
+
+  ros::serialization::OStream stream(&_buffer[0], length);
+  ros::serialization::serialize(stream, this->handleCommand);
+  ros::serialization::serialize(stream, this->lastHandleCommand);
+  ros::serialization::serialize(stream, this->prevCommand);
+  ros::serialization::serialize(stream, this->userHandleCommand);
+  ros::serialization::serialize(stream, this->handleState);
+  ros::serialization::serialize(stream,
+    static_cast<uint8_t>(this->handState));
+  ros::serialization::serialize(stream,
+    static_cast<uint8_t>(this->graspingMode));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VigirRobotiqHandPlugin::RestoreState(const std::vector<uint8_t> &_buffer)
+{
+  boost::mutex::scoped_lock lock(this->controlMutex);
+
+  if (_buffer.empty())
+    return;
+
+  uint8_t state;
+  uint8_t mode;
+  ros::serialization::IStream stream(const_cast<uint8_t *>(&_buffer[0]),
+                                     _buffer.size());
+  ros::serialization::deserialize(stream, this->handleCommand);
+  ros::serialization::deserialize(stream, this->lastHandleCommand);
+  ros::serialization::deserialize(stream, this->prevCommand);
+  ros::serialization::deserialize(stream, this->userHandleCommand);
+  ros::serialization::deserialize(stream, this->handleState);
+  ros::serialization::deserialize(stream, state);
+  ros::serialization::deserialize(stream, mode);
+  this->handState = static_cast<State>(state);
+  this->graspingMode = static_cast<GraspingMode>(mode);
+
+  // the finger poses come back with the model state, start the PIDs over
+  this->fingerControl.Reset();
+  this->lastControllerUpdateTime = this->world->GetSimTime();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void VigirRobotiqHandPlugin::ReleaseHand()
 {
@@ -311,8 +449,8 @@ bool VigirRobotiqHandPlugin::IsHandFullyOpen()
   for (int i = 2; i < this->NumJoints; ++i)
   {
     fingersOpen = fingersOpen &&
-      (this->joints[i]->GetAngle(0) <
-       (this->joints[i]->GetLowerLimit(0) + tolerance));
+      (this->jointSnapshot.angle[i] <
+       (this->lowerLimits[i] + tolerance.Radian()));
   }
 
   return fingersOpen;
@@ -323,11 +461,29 @@ void VigirRobotiqHandPlugin::UpdateStates()
 {
   boost::mutex::scoped_lock lock(this->controlMutex);
 
+  this->ApplyConfig();
+  this->ReplayCommands();
+
+  for (size_t i = 0; i < this->pendingCommands.size(); ++i)
+    this->ApplyHandleCommand(this->pendingCommands[i]);
+  this->pendingCommands.clear();
+
   gazebo::common::Time curTime = this->world->GetSimTime();
 
+  if (curTime > this->lastControllerUpdateTime &&
+      curTime - this->lastControllerUpdateTime < this->controlPeriod)
+  {
+    // Between controller updates, zero-order hold of the efforts.
+    this->fingerControl.Hold();
+    return;
+  }
+
   // Step 1: State transitions.
   if (curTime > this->lastControllerUpdateTime)
   {
+    // All of the update works on one read of the joint states.
+    this->ReadJointStates();
+
     this->userHandleCommand = this->handleCommand;
 
     // Deactivate gripper.
@@ -393,7 +549,8 @@ void VigirRobotiqHandPlugin::UpdateStates()
         break;
 
       case ICS:
-        std::cerr << "Individual Control of Scissor not supported" << std::endl;
+        VIGIR_LOG_WARN_THROTTLE(5.0,
+          "Individual Control of Scissor not supported");
         break;
 
       case ICF:
@@ -429,8 +586,8 @@ void VigirRobotiqHandPlugin::UpdateStates()
         break;
 
       default:
-        std::cerr << "Unrecognized state [" << this->handState << "]"
-                  << std::endl;
+        VIGIR_LOG_ERROR("Unrecognized state [%d]",
+                        static_cast<int>(this->handState));
     }
 
     // Update the hand controller.
@@ -439,26 +596,42 @@ void VigirRobotiqHandPlugin::UpdateStates()
     // Gather robot state data and publish them.
     this->GetAndPublishHandleState();
 
-    // Publish joint states.
-    this->GetAndPublishJointState(curTime);
+    // Publish joint states, at most at joint_state_rate.
+    if (this->jointStatePeriod <= 0 || curTime < this->lastJointStateTime ||
+        (curTime - this->lastJointStateTime).Double() >= this->jointStatePeriod)
+    {
+      this->GetAndPublishJointState(curTime);
+      this->lastJointStateTime = curTime;
+    }
 
     this->lastControllerUpdateTime = curTime;
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-uint8_t VigirRobotiqHandPlugin::GetObjectDetection(
-  const gazebo::physics::JointPtr &_joint, int _index, uint8_t _rPR,
-  uint8_t _prevrPR)
+void VigirRobotiqHandPlugin::ReadJointStates()
+{
+  for (int i = 0; i < this->NumJoints; ++i)
+  {
+    const gazebo::physics::JointPtr &joint = this->joints[i];
+    this->jointSnapshot.angle[i] = joint->GetAngle(0).Radian();
+    this->jointSnapshot.velocity[i] = joint->GetVelocity(0);
+
+    this->jointSnapshot.force[i] = this->fingerControl.GetEffort(i);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint8_t VigirRobotiqHandPlugin::GetObjectDetection(int _index, uint8_t _rPR,
+                                                   uint8_t _prevrPR)
 {
   // Check finger's speed.
-  bool isMoving = _joint->GetVelocity(0) > this->VelTolerance;
+  bool isMoving = this->jointSnapshot.velocity[_index] > this->velTolerance;
 
   // Check if the finger reached its target positions. We look at the error in
   // the position PID to decide if reached the target.
-  double pe, ie, de;
-  this->posePID[_index].GetErrors(pe, ie, de);
-  bool reachPosition = pe < this->PoseTolerance;
+  double pe = this->fingerControl.GetError(_index);
+  bool reachPosition = pe < this->poseTolerance;
 
   if (isMoving)
   {
@@ -486,22 +659,20 @@ uint8_t VigirRobotiqHandPlugin::GetObjectDetection(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-uint8_t VigirRobotiqHandPlugin::GetCurrentPosition(
-  const gazebo::physics::JointPtr &_joint)
+uint8_t VigirRobotiqHandPlugin::GetCurrentPosition(int _index)
 {
   // Full range of motion.
-  gazebo::math::Angle range =
-    _joint->GetUpperLimit(0) - _joint->GetLowerLimit(0);
+  double range = this->upperLimits[_index] - this->lowerLimits[_index];
 
   // The maximum value in pinch mode is 177.
   if (this->graspingMode == Pinch)
     range *= 177.0 / 255.0;
 
   // Angle relative to the lower limit.
-  gazebo::math::Angle relAngle = _joint->GetAngle(0) - _joint->GetLowerLimit(0);
+  double relAngle =
+    this->jointSnapshot.angle[_index] - this->lowerLimits[_index];
 
-  return
-    static_cast<uint8_t>(round(255.0 * relAngle.Radian() / range.Radian()));
+  return static_cast<uint8_t>(round(255.0 * relAngle / range));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -525,18 +696,14 @@ void VigirRobotiqHandPlugin::GetAndPublishHandleState()
     this->handleState.gIMC = 3;
 
   // Check fingers' speed.
-  bool isMovingA = this->joints[2]->GetVelocity(0) > this->VelTolerance;
-  bool isMovingB = this->joints[3]->GetVelocity(0) > this->VelTolerance;
-  bool isMovingC = this->joints[4]->GetVelocity(0) > this->VelTolerance;
+  bool isMovingA = this->jointSnapshot.velocity[2] > this->velTolerance;
+  bool isMovingB = this->jointSnapshot.velocity[3] > this->velTolerance;
+  bool isMovingC = this->jointSnapshot.velocity[4] > this->velTolerance;
 
   // Check if the fingers reached their target positions.
-  double pe, ie, de;
-  this->posePID[2].GetErrors(pe, ie, de);
-  bool reachPositionA = pe < this->PoseTolerance;
-  this->posePID[3].GetErrors(pe, ie, de);
-  bool reachPositionB = pe < this->PoseTolerance;
-  this->posePID[4].GetErrors(pe, ie, de);
-  bool reachPositionC = pe < this->PoseTolerance;
+  bool reachPositionA = this->fingerControl.GetError(2) < this->poseTolerance;
+  bool reachPositionB = this->fingerControl.GetError(3) < this->poseTolerance;
+  bool reachPositionC = this->fingerControl.GetError(4) < this->poseTolerance;
 
   // gSTA. Motion status.
   if (isMovingA || isMovingB || isMovingC)
@@ -564,19 +731,19 @@ void VigirRobotiqHandPlugin::GetAndPublishHandleState()
   }
 
   // gDTA. Finger A object detection.
-  this->handleState.gDTA = this->GetObjectDetection(this->joints[2], 2,
+  this->handleState.gDTA = this->GetObjectDetection(2,
     this->handleCommand.rPRA, this->prevCommand.rPRA);
 
   // gDTB. Finger B object detection.
-  this->handleState.gDTB = this->GetObjectDetection(this->joints[3], 3,
+  this->handleState.gDTB = this->GetObjectDetection(3,
     this->handleCommand.rPRB, this->prevCommand.rPRB);
 
   // gDTC. Finger C object detection
-  this->handleState.gDTC = this->GetObjectDetection(this->joints[4], 4,
+  this->handleState.gDTC = this->GetObjectDetection(4,
     this->handleCommand.rPRC, this->prevCommand.rPRC);
 
   // gDTS. Scissor object detection. We use finger A as a reference.
-  this->handleState.gDTS = this->GetObjectDetection(this->joints[0], 0,
+  this->handleState.gDTS = this->GetObjectDetection(0,
     this->handleCommand.rPRS, this->prevCommand.rPRS);
 
   // gFLT. Fault status.
@@ -592,48 +759,55 @@ void VigirRobotiqHandPlugin::GetAndPublishHandleState()
   // gPRA. Echo of requested position for finger A.
   this->handleState.gPRA = this->userHandleCommand.rPRA;
   // gPOA. Finger A position [0-255].
-  this->handleState.gPOA = this->GetCurrentPosition(this->joints[2]);
+  this->handleState.gPOA = this->GetCurrentPosition(2);
   // gCUA. Not implemented.
   this->handleState.gCUA = 0;
 
   // gPRB. Echo of requested position for finger B.
   this->handleState.gPRB = this->userHandleCommand.rPRB;
   // gPOB. Finger B position [0-255].
-  this->handleState.gPOB = this->GetCurrentPosition(this->joints[3]);
+  this->handleState.gPOB = this->GetCurrentPosition(3);
   // gCUB. Not implemented.
   this->handleState.gCUB = 0;
 
   // gPRC. Echo of requested position for finger C.
   this->handleState.gPRC = this->userHandleCommand.rPRC;
   // gPOC. Finger C position [0-255].
-  this->handleState.gPOC = this->GetCurrentPosition(this->joints[4]);
+  this->handleState.gPOC = this->GetCurrentPosition(4);
   // gCUS. Not implemented.
   this->handleState.gCUC = 0;
 
   // gPRS. Echo of requested position of the scissor action
   this->handleState.gPRS = this->userHandleCommand.rPRS;
   // gPOS. Scissor current position [0-255]. We use finger B as reference.
-  this->handleState.gPOS = this->GetCurrentPosition(this->joints[1]);
+  this->handleState.gPOS = this->GetCurrentPosition(1);
   // gCUS. Not implemented.
   this->handleState.gCUS = 0;
 
   // Publish robot states.
-  this->pubHandleStateQueue->push(this->handleState, this->pubHandleState);
+  this->pubHandleState.Publish(this->handleState);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void VigirRobotiqHandPlugin::GetAndPublishJointState(
                                            const gazebo::common::Time &_curTime)
 {
-  this->jointStates.header.stamp = ros::Time(_curTime.sec, _curTime.nsec);
-  for (size_t i = 0; i < this->joints.size(); ++i)
+  // nothing to publish to when replaying headless
+  if (!this->pubJointStates.IsPublishing())
+    return;
+
+  // pooled copy of the serialized template, only the stamp and the joint
+  // states are written
+  boost::shared_ptr<gazebo::JointStateTemplate::Message> msg =
+    this->pubJointStates.Allocate();
+  this->jointStateTemplate.SetStamp(*msg,
+    ros::Time(_curTime.sec, _curTime.nsec));
+  for (int i = 0; i < this->NumJoints; ++i)
   {
-    this->jointStates.position[i] = this->joints[i]->GetAngle(0).Radian();
-    this->jointStates.velocity[i] = this->joints[i]->GetVelocity(0);
-    // better to use GetForceTorque dot joint axis
-    this->jointStates.effort[i] = this->joints[i]->GetForce(0u);
+    this->jointStateTemplate.SetJoint(*msg, i, this->jointSnapshot.angle[i],
+      this->jointSnapshot.velocity[i], this->jointSnapshot.force[i]);
   }
-  this->pubJointStatesQueue->push(this->jointStates, this->pubJointStates);
+  this->pubJointStates.Publish(msg);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -641,12 +815,12 @@ void VigirRobotiqHandPlugin::UpdatePIDControl(double _dt)
 {
   if (this->handState == Disabled)
   {
-    for (int i = 0; i < this->NumJoints; ++i)
-      this->fingerJoints[i]->SetForce(0, 0.0);
-
+    this->fingerControl.Disable();
     return;
   }
 
+  double targets[NumJoints];
+  double speeds[NumJoints];
   for (int i = 0; i < this->NumJoints; ++i)
   {
     double targetPose = 0.0;
@@ -657,7 +831,7 @@ void VigirRobotiqHandPlugin::UpdatePIDControl(double _dt)
       switch (this->graspingMode)
       {
         case Wide:
-          targetPose = this->joints[i]->GetUpperLimit(0).Radian();
+          targetPose = this->upperLimits[i];
           break;
 
         case Pinch:
@@ -667,9 +841,8 @@ void VigirRobotiqHandPlugin::UpdatePIDControl(double _dt)
 
         case Scissor:
           // Max position is reached at value 215.
-          targetPose = this->joints[i]->GetUpperLimit(0).Radian() -
-            (this->joints[i]->GetUpperLimit(0).Radian() -
-             this->joints[i]->GetLowerLimit(0).Radian()) * (215.0 / 255.0)
+          targetPose = this->upperLimits[i] -
+            (this->upperLimits[i] - this->lowerLimits[i]) * (215.0 / 255.0)
             * this->handleCommand.rPRA / 255.0;
           break;
       }
@@ -679,7 +852,7 @@ void VigirRobotiqHandPlugin::UpdatePIDControl(double _dt)
       switch (this->graspingMode)
       {
         case Wide:
-          targetPose = this->joints[i]->GetLowerLimit(0).Radian();
+          targetPose = this->lowerLimits[i];
           break;
 
         case Pinch:
@@ -689,9 +862,8 @@ void VigirRobotiqHandPlugin::UpdatePIDControl(double _dt)
 
         case Scissor:
         // Max position is reached at value 215.
-          targetPose = this->joints[i]->GetLowerLimit(0).Radian() +
-            (this->joints[i]->GetUpperLimit(0).Radian() -
-             this->joints[i]->GetLowerLimit(0).Radian()) * (215.0 / 255.0)
+          targetPose = this->lowerLimits[i] +
+            (this->upperLimits[i] - this->lowerLimits[i]) * (215.0 / 255.0)
             * this->handleCommand.rPRA / 255.0;
           break;
       }
@@ -701,9 +873,8 @@ void VigirRobotiqHandPlugin::UpdatePIDControl(double _dt)
       if (this->graspingMode == Pinch)
       {
         // Max position is reached at value 177.
-        targetPose = this->joints[i]->GetLowerLimit(0).Radian() +
-          (this->joints[i]->GetUpperLimit(0).Radian() -
-           this->joints[i]->GetLowerLimit(0).Radian()) * (177.0 / 255.0)
+        targetPose = this->lowerLimits[i] +
+          (this->upperLimits[i] - this->lowerLimits[i]) * (177.0 / 255.0)
           * this->handleCommand.rPRA / 255.0;
       }
       else if (this->graspingMode == Scissor)
@@ -714,25 +885,17 @@ void VigirRobotiqHandPlugin::UpdatePIDControl(double _dt)
       }
       else
       {
-        targetPose = this->joints[i]->GetLowerLimit(0).Radian() +
-          (this->joints[i]->GetUpperLimit(0).Radian() -
-           this->joints[i]->GetLowerLimit(0).Radian())
+        targetPose = this->lowerLimits[i] +
+          (this->upperLimits[i] - this->lowerLimits[i])
           * this->handleCommand.rPRA / 255.0;
       }
     }
 
-    // Get the current pose.
-    double currentPose = this->joints[i]->GetAngle(0).Radian();
-
-    // Position error.
-    double poseError = currentPose - targetPose;
-
-    // Update the PID.
-    double torque = this->posePID[i].Update(poseError, _dt);
-
-    // Apply the PID command.
-    this->fingerJoints[i]->SetForce(0, torque);
+    targets[i] = targetPose;
+    speeds[i] = targetSpeed;
   }
+
+  this->fingerControl.Update(this->jointSnapshot.angle, targets, speeds, _dt);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -861,13 +1024,129 @@ bool VigirRobotiqHandPlugin::FindJoints()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void VigirRobotiqHandPlugin::RosQueueThread()
+void VigirRobotiqHandPlugin::LoadConfig()
 {
-  static const double timeout = 0.01;
+  Config seed = Config::__getDefault__();
+  if (this->sdf->HasElement("kp_position"))
+    seed.kp_position = this->sdf->Get<double>("kp_position");
+  if (this->sdf->HasElement("ki_position"))
+    seed.ki_position = this->sdf->Get<double>("ki_position");
+  if (this->sdf->HasElement("kd_position"))
+    seed.kd_position = this->sdf->Get<double>("kd_position");
+  if (this->sdf->HasElement("control_rate"))
+    seed.control_rate = this->sdf->Get<double>("control_rate");
+  if (this->sdf->HasElement("position_effort_min"))
+    seed.position_effort_min = this->sdf->Get<double>("position_effort_min");
+  if (this->sdf->HasElement("position_effort_max"))
+    seed.position_effort_max = this->sdf->Get<double>("position_effort_max");
+
+  if (this->rosNode)
+  {
+    ros::NodeHandle reconfigureNode(
+      std::string("robotiq_hands/") + this->side + "_hand");
+    reconfigureNode.setCallbackQueue(&this->rosQueue);
+    this->reconfigureServer.reset(
+      new dynamic_reconfigure::Server<Config>(reconfigureNode));
+    this->reconfigureServer->updateConfig(seed);
+  }
 
-  while (this->rosNode->ok())
+  boost::atomic_store(&this->config,
+    boost::shared_ptr<const Config>(new Config(seed)));
+
+  if (this->reconfigureServer)
   {
-    this->rosQueue.callAvailable(ros::WallDuration(timeout));
+    this->reconfigureServer->setCallback(
+      boost::bind(&VigirRobotiqHandPlugin::OnReconfigure, this, _1, _2));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VigirRobotiqHandPlugin::OnReconfigure(Config &_config,
+                                           uint32_t /*_level*/)
+{
+  // Picked up by the next controller update.
+  boost::atomic_store(&this->config,
+    boost::shared_ptr<const Config>(new Config(_config)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VigirRobotiqHandPlugin::ApplyConfig()
+{
+  boost::shared_ptr<const Config> latest = boost::atomic_load(&this->config);
+  if (!latest || latest == this->appliedConfig)
+    return;
+
+  if (!this->appliedConfig ||
+      this->appliedConfig->kp_position != latest->kp_position ||
+      this->appliedConfig->ki_position != latest->ki_position ||
+      this->appliedConfig->kd_position != latest->kd_position)
+  {
+    for (int i = 0; i < this->NumJoints; ++i)
+    {
+      const GainOverride &gains = this->gainOverrides[i];
+      this->fingerControl.SetGains(i,
+        gains.kp >= 0 ? gains.kp : latest->kp_position,
+        gains.ki >= 0 ? gains.ki : latest->ki_position,
+        gains.kd >= 0 ? gains.kd : latest->kd_position);
+    }
+  }
+
+  if (!this->appliedConfig ||
+      this->appliedConfig->position_effort_min !=
+        latest->position_effort_min ||
+      this->appliedConfig->position_effort_max != latest->position_effort_max)
+  {
+    this->fingerControl.SetEffortLimits(latest->position_effort_min,
+                                        latest->position_effort_max);
+  }
+
+  this->velTolerance = latest->vel_tolerance;
+  this->poseTolerance = latest->pose_tolerance;
+  this->jointStatePeriod = latest->joint_state_rate > 0 ?
+    1.0 / latest->joint_state_rate : 0.0;
+  this->controlPeriod = latest->control_rate > 0 ?
+    gazebo::common::Time(1.0 / latest->control_rate) :
+    gazebo::common::Time(0, 0);
+  this->appliedConfig = latest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VigirRobotiqHandPlugin::LoadJointGains()
+{
+  if (!this->sdf->HasElement("joint_gain"))
+    return;
+
+  for (sdf::ElementPtr elem = this->sdf->GetElement("joint_gain"); elem;
+       elem = elem->GetNextElement("joint_gain"))
+  {
+    std::string name;
+    if (elem->HasElement("joint"))
+      name = elem->Get<std::string>("joint");
+
+    int index = -1;
+    for (size_t i = 0; i < this->jointNames.size(); ++i)
+    {
+      if (this->jointNames[i] == name ||
+          this->jointNames[i] == this->side + "_" + name)
+      {
+        index = static_cast<int>(i);
+        break;
+      }
+    }
+    if (index < 0)
+    {
+      gzerr << "Ignoring <joint_gain> for unknown joint [" << name << "] of "
+            << this->side << " hand." << std::endl;
+      continue;
+    }
+
+    GainOverride &gains = this->gainOverrides[index];
+    if (elem->HasElement("kp"))
+      gains.kp = elem->Get<double>("kp");
+    if (elem->HasElement("ki"))
+      gains.ki = elem->Get<double>("ki");
+    if (elem->HasElement("kd"))
+      gains.kd = elem->Get<double>("kd");
   }
 }
 
@@ -0,0 +1,375 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+/// \brief Headless batch runner for VRC scenarios.
+///
+/// Every scenario is a world file (including atlas, the hands and the
+/// VRCPlugin) plus a command log recorded with VRC_COMMAND_LOG.  Each
+/// scenario runs in its own gazebo server process, with the real time update
+/// rate set to 0 so physics steps as fast as possible, and the commands
+/// are replayed in lockstep without a ROS master.
+///
+/// Usage:
+///   vigir_scenario_runner [-j jobs] [-o results.csv] [-r robot]
+///                         [-f fall_height] scenarios.txt
+///
+/// scenarios.txt has one scenario per line, '#' starts a comment:
+///   <name> <world_file> <replay_log> <sim_seconds>
+/// Use '-' as replay_log to run a world without commands.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+/// \brief One line of the scenario file.
+struct Scenario
+{
+  /// \brief Scenario name, first column of the results.
+  std::string name;
+
+  /// \brief World file to load.
+  std::string worldFile;
+
+  /// \brief Command log to replay, empty for none.
+  std::string replayLog;
+
+  /// \brief Sim time to run for.
+  double simSeconds;
+};
+
+/// \brief Runner options.
+struct Options
+{
+  /// \brief Number of scenarios run in parallel.
+  int jobs;
+
+  /// \brief Robot model name used for the pose metrics.
+  std::string robot;
+
+  /// \brief The robot counts as fallen if its origin drops below this.
+  double fallHeight;
+
+  /// \brief Results file, empty for stdout.
+  std::string output;
+};
+
+/// \brief Header of the results csv.
+static const char *ResultHeader =
+  "name,status,iterations,sim_time,wall_time,rtf,x,y,z,roll,pitch,yaw,fell";
+
+/// \brief Iterations run between two fall checks.
+static const unsigned int CheckIterations = 100;
+
+////////////////////////////////////////////////////////////////////////////////
+// Wall clock in seconds.
+static double WallTime()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read the scenario file.
+static bool LoadScenarios(const std::string &_path,
+                          std::vector<Scenario> &_scenarios)
+{
+  std::ifstream in(_path.c_str());
+  if (!in)
+  {
+    std::cerr << "Unable to open scenario file [" << _path << "]\n";
+    return false;
+  }
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(in, line))
+  {
+    ++lineNumber;
+    size_t comment = line.find('#');
+    if (comment != std::string::npos)
+      line.erase(comment);
+
+    std::istringstream fields(line);
+    Scenario scenario;
+    if (!(fields >> scenario.name))
+      continue;
+
+    if (!(fields >> scenario.worldFile >> scenario.replayLog
+                 >> scenario.simSeconds))
+    {
+      std::cerr << _path << ":" << lineNumber << ": expected "
+                << "<name> <world_file> <replay_log> <sim_seconds>\n";
+      return false;
+    }
+
+    if (scenario.replayLog == "-")
+      scenario.replayLog.clear();
+
+    _scenarios.push_back(scenario);
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Result line for a scenario that didn't produce one.
+static std::string FailedResult(const Scenario &_scenario,
+                                const std::string &_status)
+{
+  return _scenario.name + "," + _status + ",0,0,0,0,0,0,0,0,0,0,0";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Run one scenario in this process and return its result line.  Only
+// called in a freshly forked child, gazebo can load one server per process.
+static std::string RunScenario(const Scenario &_scenario,
+                               const Options &_options)
+{
+  // Picked up by VRCPlugin and the Robotiq hand plugins on load.
+  if (!_scenario.replayLog.empty())
+  {
+    setenv("VRC_REPLAY_LOG", _scenario.replayLog.c_str(), 1);
+    setenv("VRC_LOCKSTEP", "1", 1);
+  }
+  unsetenv("VRC_COMMAND_LOG");
+
+  if (!gazebo::setupServer())
+    return FailedResult(_scenario, "setup_failed");
+
+  gazebo::physics::WorldPtr world = gazebo::loadWorld(_scenario.worldFile);
+  if (!world)
+  {
+    gazebo::shutdown();
+    return FailedResult(_scenario, "load_failed");
+  }
+
+  // no real time throttling, step as fast as possible
+  world->GetPhysicsEngine()->SetRealTimeUpdateRate(0.0);
+  unsigned int iterations = static_cast<unsigned int>(
+    _scenario.simSeconds / world->GetPhysicsEngine()->GetMaxStepSize() + 0.5);
+
+  bool fell = false;
+  double start = WallTime();
+  unsigned int done = 0;
+  while (done < iterations)
+  {
+    unsigned int step = std::min(CheckIterations, iterations - done);
+    gazebo::runWorld(world, step);
+    done += step;
+
+    gazebo::physics::ModelPtr robot = world->GetModel(_options.robot);
+    if (robot && robot->GetWorldPose().pos.z < _options.fallHeight)
+      fell = true;
+  }
+  double wallTime = WallTime() - start;
+
+  gazebo::math::Pose pose;
+  std::string status = "ok";
+  gazebo::physics::ModelPtr robot = world->GetModel(_options.robot);
+  if (robot)
+    pose = robot->GetWorldPose();
+  else
+    status = "no_robot";
+
+  double simTime = world->GetSimTime().Double();
+  gazebo::math::Vector3 rpy = pose.rot.GetAsEuler();
+
+  std::ostringstream result;
+  result << _scenario.name << "," << status << ","
+         << world->GetIterations() << "," << simTime << "," << wallTime << ","
+         << (wallTime > 0 ? simTime / wallTime : 0) << ","
+         << pose.pos.x << "," << pose.pos.y << "," << pose.pos.z << ","
+         << rpy.x << "," << rpy.y << "," << rpy.z << ","
+         << (fell ? 1 : 0);
+
+  gazebo::shutdown();
+  return result.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read everything a child wrote to its result pipe.
+static std::string ReadResult(int _fd)
+{
+  std::string result;
+  char buffer[512];
+  ssize_t n;
+  while ((n = read(_fd, buffer, sizeof(buffer))) != 0)
+  {
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    result.append(buffer, n);
+  }
+
+  size_t end = result.find('\n');
+  if (end != std::string::npos)
+    result.erase(end);
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void Usage()
+{
+  std::cerr << "Usage: vigir_scenario_runner [-j jobs] [-o results.csv] "
+            << "[-r robot] [-f fall_height] scenarios.txt\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int _argc, char **_argv)
+{
+  Options options;
+  options.jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  options.robot = "atlas";
+  options.fallHeight = 0.5;
+
+  int opt;
+  while ((opt = getopt(_argc, _argv, "j:o:r:f:h")) != -1)
+  {
+    switch (opt)
+    {
+      case 'j':
+        options.jobs = atoi(optarg);
+        break;
+      case 'o':
+        options.output = optarg;
+        break;
+      case 'r':
+        options.robot = optarg;
+        break;
+      case 'f':
+        options.fallHeight = atof(optarg);
+        break;
+      default:
+        Usage();
+        return 1;
+    }
+  }
+
+  if (optind != _argc - 1)
+  {
+    Usage();
+    return 1;
+  }
+  if (options.jobs < 1)
+    options.jobs = 1;
+
+  std::vector<Scenario> scenarios;
+  if (!LoadScenarios(_argv[optind], scenarios))
+    return 1;
+
+  // one gazebo server per worker process, results come back over a pipe
+  std::vector<std::string> results(scenarios.size());
+  std::map<pid_t, std::pair<size_t, int> > running;
+  size_t next = 0;
+  while (next < scenarios.size() || !running.empty())
+  {
+    while (next < scenarios.size() &&
+           static_cast<int>(running.size()) < options.jobs)
+    {
+      int fds[2];
+      if (pipe(fds) != 0)
+      {
+        perror("pipe");
+        return 1;
+      }
+
+      pid_t pid = fork();
+      if (pid < 0)
+      {
+        perror("fork");
+        return 1;
+      }
+
+      if (pid == 0)
+      {
+        close(fds[0]);
+        std::string result = RunScenario(scenarios[next], options) + "\n";
+        if (write(fds[1], result.c_str(), result.size()) < 0)
+          _exit(1);
+        close(fds[1]);
+        _exit(0);
+      }
+
+      close(fds[1]);
+      running[pid] = std::make_pair(next, fds[0]);
+      std::cerr << "[" << scenarios[next].name << "] started\n";
+      ++next;
+    }
+
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      perror("waitpid");
+      return 1;
+    }
+
+    std::map<pid_t, std::pair<size_t, int> >::iterator it = running.find(pid);
+    if (it == running.end())
+      continue;
+
+    size_t index = it->second.first;
+    results[index] = ReadResult(it->second.second);
+    close(it->second.second);
+    running.erase(it);
+
+    if (results[index].empty())
+      results[index] = FailedResult(scenarios[index], "crashed");
+    std::cerr << "[" << scenarios[index].name << "] finished\n";
+  }
+
+  // merge in scenario file order
+  std::ofstream file;
+  if (!options.output.empty())
+  {
+    file.open(options.output.c_str());
+    if (!file)
+    {
+      std::cerr << "Unable to write results to [" << options.output << "]\n";
+      return 1;
+    }
+  }
+  std::ostream &out = options.output.empty() ? std::cout : file;
+
+  out << ResultHeader << "\n";
+  for (size_t i = 0; i < results.size(); ++i)
+    out << results[i] << "\n";
+
+  return 0;
+}
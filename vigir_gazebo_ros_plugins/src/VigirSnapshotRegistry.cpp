@@ -0,0 +1,74 @@
+/*
+ * Copyright 2026 Team ViGIR
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <vigir_gazebo_ros_plugins/VigirSnapshotRegistry.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+SnapshotRegistry &SnapshotRegistry::Instance()
+{
+  static SnapshotRegistry registry;
+  return registry;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SnapshotRegistry::Register(const std::string &_name,
+                                const SaveFunc &_save,
+                                const RestoreFunc &_restore)
+{
+  boost::mutex::scoped_lock lock(this->mutex);
+  this->plugins[_name] = std::make_pair(_save, _restore);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SnapshotRegistry::Unregister(const std::string &_name)
+{
+  boost::mutex::scoped_lock lock(this->mutex);
+  this->plugins.erase(_name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SnapshotRegistry::Save(PluginStates &_states)
+{
+  boost::mutex::scoped_lock lock(this->mutex);
+  _states.clear();
+  for (std::map<std::string, std::pair<SaveFunc, RestoreFunc> >::iterator it =
+       this->plugins.begin(); it != this->plugins.end(); ++it)
+  {
+    it->second.first(_states[it->first]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SnapshotRegistry::Restore(const PluginStates &_states)
+{
+  boost::mutex::scoped_lock lock(this->mutex);
+  for (PluginStates::const_iterator it = _states.begin(); it != _states.end();
+       ++it)
+  {
+    std::map<std::string, std::pair<SaveFunc, RestoreFunc> >::iterator
+      plugin = this->plugins.find(it->first);
+    if (plugin != this->plugins.end())
+      plugin->second.second(it->second);
+  }
+}
+}
@@ -15,17 +15,72 @@
  *
 */
 
+#include <algorithm>
+#include <fstream>
 #include <map>
+#include <sstream>
 #include <string>
 #include <stdlib.h>
 
 #include <angles/angles.h>
 #include <gazebo/transport/transport.hh>
 #include <gazebo/physics/CylinderShape.hh>
+#include <vigir_gazebo_ros_plugins/VigirModelCache.h>
 #include <vigir_gazebo_ros_plugins/VigirVRCPlugin.h>
 
 namespace gazebo
 {
+/// \brief Collision category of the robot while welded to the vehicle with
+/// <disable_cab_collision>.
+static const unsigned int RobotCollideBit = 0x04000000;
+
+/// \brief Collision category of the vehicle while the robot is welded to it
+/// with <disable_cab_collision>.
+static const unsigned int CabCollideBit = 0x08000000;
+
+typedef vigir_gazebo_ros_plugins::VRCPluginConfig PluginConfig;
+
+/// \brief Tunables of one startup phase, negative values keep the startup
+/// profile timing.
+struct StartupPhaseTunables
+{
+  /// \brief Phase name, also the atlas/startup/<name>/ param namespace.
+  const char *name;
+
+  /// \brief Config members of the phase duration, minimum duration and
+  /// joint tolerance.
+  double PluginConfig::*duration;
+  double PluginConfig::*minDuration;
+  double PluginConfig::*jointTolerance;
+};
+
+/// \brief Tunables of every startup phase LoadStartupPhases builds.
+static const StartupPhaseTunables StartupTunables[] =
+{
+  {"pinned",
+   &PluginConfig::pinned_duration,
+   &PluginConfig::pinned_min_duration,
+   &PluginConfig::pinned_joint_tolerance},
+  {"pid_stand",
+   &PluginConfig::pid_stand_duration,
+   &PluginConfig::pid_stand_min_duration,
+   &PluginConfig::pid_stand_joint_tolerance},
+  {"stand_prep",
+   &PluginConfig::stand_prep_duration,
+   &PluginConfig::stand_prep_min_duration,
+   &PluginConfig::stand_prep_joint_tolerance},
+  {"nominal",
+   &PluginConfig::nominal_duration,
+   &PluginConfig::nominal_min_duration,
+   &PluginConfig::nominal_joint_tolerance},
+  {"stand",
+   &PluginConfig::stand_duration,
+   &PluginConfig::stand_min_duration,
+   &PluginConfig::stand_joint_tolerance}
+};
+static const unsigned int NumStartupTunables =
+  sizeof(StartupTunables) / sizeof(StartupTunables[0]);
+
 GZ_REGISTER_WORLD_PLUGIN(VRCPlugin)
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -35,6 +90,19 @@ VRCPlugin::VRCPlugin()
   /// initial anchor pose
   this->warpRobotWithCmdVel = false;
   this->rosNode = NULL;
+  this->nextCommandTick = 0;
+  this->worldEditDepth = 0;
+  this->worldEditDeferred = 0;
+  this->worldEditActive = false;
+  this->worldEditPaused = false;
+  this->worldEditPhysics = true;
+  this->vehicleRobotJointReleaseTime = -1.0;
+  this->grabMaxDistance = 0.3;
+  this->robotStartInVehicle = false;
+  this->kinematicSubtreesEnabled = false;
+  this->nominalProfile = CollisionProfiles::NoProfile;
+  this->warpProfile = CollisionProfiles::NoProfile;
+  this->seatedProfile = CollisionProfiles::NoProfile;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -42,10 +110,13 @@ VRCPlugin::VRCPlugin()
 VRCPlugin::~VRCPlugin()
 {
   event::Events::DisconnectWorldUpdateBegin(this->updateConnection);
-  this->rosNode->shutdown();
-  this->rosQueue.clear();
-  this->rosQueue.disable();
-  this->callbackQueueThread.join();
+  this->reconfigureServer.reset();
+  if (this->rosNode)
+    this->rosNode->shutdown();
+  if (this->atlasCommandController.rosNode)
+    this->atlasCommandController.rosNode->shutdown();
+  this->atlas.pubFakeASIS.Shutdown();
+  this->rosQueue.Shutdown();
   delete this->rosNode;
 }
 
@@ -57,6 +128,9 @@ void VRCPlugin::Load(physics::WorldPtr _parent, sdf::ElementPtr _sdf)
   this->world = _parent;
   this->sdf = _sdf;
 
+  // start the log writer thread before the first world update
+  AsyncLog::Instance();
+
   // By default, cheats are off.  Allow override via environment variable.
   char* cheatsEnabledString = getenv("VRC_CHEATS_ENABLED");
   if (cheatsEnabledString && (std::string(cheatsEnabledString) == "1"))
@@ -64,6 +138,34 @@ void VRCPlugin::Load(physics::WorldPtr _parent, sdf::ElementPtr _sdf)
   else
     this->cheatsEnabled = false;
 
+  // Command record / replay.  <command_log> records every command as it is
+  // applied, <replay_log> feeds a recorded log back in at the same ticks.
+  // VRC_COMMAND_LOG and VRC_REPLAY_LOG override both, and are shared with
+  // the Robotiq hand plugins.
+  std::string commandLogName =
+    GetCommandLogPath(this->sdf, "command_log", "VRC_COMMAND_LOG");
+  std::string replayLogName =
+    GetCommandLogPath(this->sdf, "replay_log", "VRC_REPLAY_LOG");
+  if (!replayLogName.empty())
+  {
+    this->commandReplay.reset(new CommandLogReader());
+    if (this->commandReplay->Load(replayLogName, CS_VRC))
+    {
+      ROS_INFO("VRCPlugin: replaying %lu commands from [%s].",
+               static_cast<unsigned long>(this->commandReplay->Size()),
+               replayLogName.c_str());
+    }
+    else
+      this->commandReplay.reset();
+  }
+  if (!commandLogName.empty())
+  {
+    this->commandLog = CommandLogWriter::Open(commandLogName);
+    if (this->commandLog)
+      ROS_INFO("VRCPlugin: recording commands to [%s].",
+               commandLogName.c_str());
+  }
+
   // ros callback queue for processing subscription
   // this->deferredLoadThread = boost::thread(
   //   boost::bind(&VRCPlugin::DeferredLoad, this));
@@ -75,19 +177,32 @@ void VRCPlugin::Load(physics::WorldPtr _parent, sdf::ElementPtr _sdf)
 void VRCPlugin::DeferredLoad()
 {
   // initialize ros
+  bool headless = false;
   if (!ros::isInitialized())
   {
-    gzerr << "Not loading vrc plugin since ROS hasn't been "
-          << "properly initialized.  Try starting gazebo with ros plugin:\n"
-          << "  gazebo -s libgazebo_ros_api_plugin.so\n";
-    return;
+    if (!this->commandReplay)
+    {
+      gzerr << "Not loading vrc plugin since ROS hasn't been "
+            << "properly initialized.  Try starting gazebo with ros plugin:\n"
+            << "  gazebo -s libgazebo_ros_api_plugin.so\n";
+      return;
+    }
+
+    // replaying a command log doesn't need a ROS master, the robot has to
+    // be included in the world file though.
+    gzmsg << "VRCPlugin: ROS not initialized, replaying commands headless.\n";
+    ros::Time::init();
+    headless = true;
   }
 
-  // ros stuff
-  this->rosNode = new ros::NodeHandle("");
+  if (!headless)
+  {
+    // ros stuff
+    this->rosNode = new ros::NodeHandle("");
 
-  // load VRC ROS API
-  this->LoadVRCROSAPI();
+    // load VRC ROS API
+    this->LoadVRCROSAPI();
+  }
 
   // this->world->GetPhysicsEngine()->SetGravity(math::Vector3(0,0,0));
   this->lastUpdateTime = this->world->GetSimTime().Double();
@@ -99,24 +214,21 @@ void VRCPlugin::DeferredLoad()
   // Load fire hose and standpipe
   this->drcFireHose.Load(this->world, this->sdf);
 
-  // Setup ROS interfaces for robot
-  this->LoadRobotROSAPI();
+  // props that may sleep, static ones are skipped
+  this->propSleep.AddModel(this->drcVehicle.model);
+  this->propSleep.AddModel(this->drcFireHose.fireHoseModel);
+  this->propSleep.AddModel(this->drcFireHose.standpipeModel);
+  this->propSleep.AddModel(this->drcFireHose.valveModel);
 
-  // ros callback queue for processing subscription
-  this->callbackQueueThread = boost::thread(
-    boost::bind(&VRCPlugin::ROSQueueThread, this));
+  // tunables first, the startup phases are built from them
+  this->LoadConfig();
+  this->ApplyConfig();
 
-  std::string cmdVelTimeout = "cmd_vel_timeout";
-  if (this->rosNode->getParam(cmdVelTimeout, this->cmdVelTopicTimeout))
-  {
-    ROS_INFO("atlas fake walk teleop command timeout set to %f seconds.",
-             this->cmdVelTopicTimeout);
-  }
-  else
+  if (!headless)
   {
-    ROS_INFO("atlas fake walk teleop command timeout param not set, "
-             "defaults to 0.1 seconds.\n");
-    this->cmdVelTopicTimeout = 0.1;
+    // Setup ROS interfaces for robot, the callbacks run on the shared
+    // PluginExecutor
+    this->LoadRobotROSAPI();
   }
 
   // Mechanism for Updating every World Cycle
@@ -130,8 +242,8 @@ void VRCPlugin::DeferredLoad()
 void VRCPlugin::PinAtlas(bool _with_gravity)
 {
   // pinning robot, potentially turning off effect of gravity
-  if (this->vehicleRobotJoint)
-    this->RemoveJoint(this->vehicleRobotJoint);
+  this->robotMode.clear();
+  this->UnweldRobotFromVehicle();
   if (!this->atlas.pinJoint)
     this->atlas.pinJoint = this->AddJoint(this->world,
                                       this->atlas.model,
@@ -145,20 +257,21 @@ void VRCPlugin::PinAtlas(bool _with_gravity)
 
   this->atlas.model->SetGravityMode(_with_gravity);
 
-  this->SetFeetCollide("none");
+  this->SetCollisionProfile(this->warpProfile);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void VRCPlugin::UnpinAtlas()
 {
   // nominal
+  this->robotMode.clear();
   this->warpRobotWithCmdVel = false;
+  this->SetKinematicSubtrees(false);
   this->atlas.model->SetGravityMode(true);
   if (this->atlas.pinJoint)
     this->RemoveJoint(this->atlas.pinJoint);
-  if (this->vehicleRobotJoint)
-    this->RemoveJoint(this->vehicleRobotJoint);
-  this->SetFeetCollide("all");
+  this->UnweldRobotFromVehicle();
+  this->SetCollisionProfile(this->nominalProfile);
 
   if (this->world->GetPhysicsEngine()->GetType() == "simbody" ||
       this->world->GetPhysicsEngine()->GetType() == "dart")
@@ -174,19 +287,42 @@ void VRCPlugin::UnpinAtlas()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void VRCPlugin::SetFeetCollide(const std::string &_mode)
+void VRCPlugin::LoadCollisionProfiles()
 {
-  physics::LinkPtr l_foot_link = this->atlas.model->GetLink("l_foot");
-  if (!l_foot_link)
-    ROS_WARN("Couldn't find l_foot link when setting collide mode");
-  else
-    l_foot_link->SetCollideMode(_mode);
+  this->collisionProfiles.Clear();
+  this->collisionProfiles.AddModel(this->atlas.model);
+  this->collisionProfiles.AddModel(this->drcVehicle.model);
 
-  physics::LinkPtr r_foot_link = this->atlas.model->GetLink("r_foot");
-  if (!r_foot_link)
-    ROS_WARN("Couldn't find r_foot link when setting collide mode");
-  else
-    r_foot_link->SetCollideMode(_mode);
+  this->nominalProfile = this->collisionProfiles.Define("nominal");
+
+  this->warpProfile = this->collisionProfiles.Define("warp");
+  const char *feet[] = {"l_foot", "r_foot"};
+  for (unsigned int i = 0; i < 2; ++i)
+  {
+    physics::LinkPtr foot = this->atlas.model->GetLink(feet[i]);
+    if (!foot)
+      ROS_WARN("Couldn't find %s link for the warp collision profile",
+               feet[i]);
+    else
+      this->collisionProfiles.SetLink(this->warpProfile, foot, 0, 0);
+  }
+
+  // robot and cab get a category bit of their own and stop colliding
+  // with each other, everything else still collides with both
+  this->seatedProfile = this->collisionProfiles.Define("seated");
+  this->collisionProfiles.SetModel(this->seatedProfile, this->atlas.model,
+                                   RobotCollideBit, CabCollideBit);
+  this->collisionProfiles.SetModel(this->seatedProfile,
+                                   this->drcVehicle.model,
+                                   CabCollideBit, RobotCollideBit);
+
+  this->collisionProfiles.Apply(this->nominalProfile);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::SetCollisionProfile(CollisionProfiles::Id _id)
+{
+  this->collisionProfiles.Apply(_id);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -198,172 +334,317 @@ void VRCPlugin::SetRobotModeTopic(const std_msgs::String::ConstPtr &_str)
 ////////////////////////////////////////////////////////////////////////////////
 void VRCPlugin::SetRobotMode(const std::string &_str)
 {
-  if (_str == "no_gravity")
+  const RobotMode *mode = NULL;
+  for (unsigned int i = 0; i < this->robotModes.size(); ++i)
   {
-    // stop warping robot
-    this->warpRobotWithCmdVel = false;
-    this->atlas.model->SetGravityMode(false);
-    if (this->atlas.pinJoint)
-      this->RemoveJoint(this->atlas.pinJoint);
-    if (this->vehicleRobotJoint)
-      this->RemoveJoint(this->vehicleRobotJoint);
+    if (this->robotModes[i].name == _str)
+    {
+      mode = &this->robotModes[i];
+      break;
+    }
   }
-  else if (_str == "feet")
+  if (!mode)
   {
-    // stop warping robot
-    this->warpRobotWithCmdVel = false;
+    std::string names;
+    for (unsigned int i = 0; i < this->robotModes.size(); ++i)
+      names += (i > 0 ? ", " : "") + this->robotModes[i].name;
+    ROS_INFO("available modes:%s", names.c_str());
+    return;
+  }
 
-    this->atlas.model->SetGravityMode(false);
-    this->atlas.model->GetLink("l_foot")->SetGravityMode(true);
-    this->atlas.model->GetLink("r_foot")->SetGravityMode(true);
+  // everything below only changes what differs from the current state,
+  // the posture and gains are only set when the mode changes
+  bool changed = (_str != this->robotMode);
+  WorldEdit edit(this);
 
-    if (this->atlas.pinJoint)
-      this->RemoveJoint(this->atlas.pinJoint);
-    if (this->vehicleRobotJoint)
-      this->RemoveJoint(this->vehicleRobotJoint);
-  }
-  else if (_str == "harnessed")
-  {
-    bool paused = this->world->IsPaused();
-    this->world->SetPaused(true);
+  if (!mode->kinematic)
+    this->SetKinematicSubtrees(false);
+  this->UnweldRobotFromVehicle();
 
-    // remove pin
-    if (this->atlas.pinJoint)
-      this->RemoveJoint(this->atlas.pinJoint);
-    if (this->vehicleRobotJoint)
-      this->RemoveJoint(this->vehicleRobotJoint);
+  switch (mode->pin)
+  {
+    case PIN_NONE:
+      // stop warping robot
+      this->warpRobotWithCmdVel = false;
+      if (this->atlas.pinJoint)
+        this->RemoveJoint(this->atlas.pinJoint);
+      if (this->world->GetPhysicsEngine()->GetType() == "simbody" ||
+          this->world->GetPhysicsEngine()->GetType() == "dart")
+      {
+        // simulate un-freezing simbody or dart unlock free joints
+        physics::Link_V links = this->atlas.model->GetLinks();
+        for (unsigned int i = 0; i < links.size(); ++i)
+          links[i]->SetLinkStatic(false);
+      }
+      break;
+    case PIN_CURRENT:
+      if (!this->atlas.pinJoint)
+      {
+        this->atlas.pinJoint = this->AddJoint(this->world,
+                                          this->atlas.model,
+                                          physics::LinkPtr(),
+                                          this->atlas.pinLink,
+                                          "revolute",
+                                          math::Vector3(0, 0, 0),
+                                          math::Vector3(0, 0, 1),
+                                          0.0, 0.0);
+      }
+      // the cmd_vel warp holds the height of the last pin, re-pinning
+      // where the robot is now keeps it from snapping back
+      this->atlas.initialPose = this->atlas.pinLink->GetWorldPose();
+      break;
+    case PIN_HARNESS:
+      if (changed || !this->atlas.pinJoint)
+        this->HarnessAtlas();
+      break;
+  }
 
-    // raise robot, find ground height, set it down and upright it, then pin it
-    math::Pose atlasPose = this->atlas.pinLink->GetWorldPose();
+  physics::Link_V links = this->atlas.model->GetLinks();
+  for (unsigned int i = 0; i < links.size() &&
+       i < mode->linkGravity.size(); ++i)
+  {
+    if (links[i]->GetGravityMode() != mode->linkGravity[i])
+      links[i]->SetGravityMode(mode->linkGravity[i]);
+  }
 
-    // where to raise robot to
-    math::Pose atlasAway = atlasPose + math::Pose(0, 0, 50.0, 0, 0, 0);
+  if (mode->profile != CollisionProfiles::NoProfile &&
+      mode->profile != this->collisionProfiles.Active())
+    this->SetCollisionProfile(mode->profile);
 
-    // move robot out of the way
-    this->atlas.model->SetLinkWorldPose(atlasAway, this->atlas.pinLink);
+  if (mode->kinematic)
+    this->SetKinematicSubtrees(true);
 
-    // where to start down casting ray to check for ground
-    math::Pose rayStart = atlasPose - math::Pose(0, 0, -2.0, 0, 0, 0);
+  if (changed)
+  {
+    if (!mode->gains.empty())
+      this->atlasCommandController.LoadGains(mode->gains);
 
-    double distBelow = 0.0;
-    physics::EntityPtr entityBelow;
-    physics::EntityPtr fromEntity = this->atlas.pinLink;
-    std::string objectBelow;
-    fromEntity->GetNearestEntityBelow(distBelow, objectBelow);
-    entityBelow = this->world->GetEntity(objectBelow);
-    gzdbg << fromEntity->GetName() << " "
-          << distBelow << " " << objectBelow << "\n";
-    // if entity below is part of atlas, set it to fromEntity
-    // and keep searching below
-    while (entityBelow && (entityBelow->GetParentModel() ==
-      fromEntity->GetParentModel()))
-    {
-      objectBelow.clear();
-      fromEntity = entityBelow;
-      fromEntity->GetNearestEntityBelow(distBelow, objectBelow);
-      entityBelow = this->world->GetEntity(objectBelow);
-      gzdbg << fromEntity->GetName() << " "
-            << distBelow << " " << objectBelow << "\n";
-    }
-    if (entityBelow && fromEntity)
-    {
-      // gzdbg << objectBelow << "\n";
-      // gzdbg << groundHeight << "\n";
-      // gzdbg << groundBB.max.z << "\n";
-      // gzdbg << groundBB.min.z << "\n";
-
-      // slightly above ground and upright
-      // fromEntity->GetCollisionBoundingBox().min.z gives us the
-      // lowest point of atlas robot. Set pin location to 1.15m
-      // above it.
-      atlasPose.pos.z = fromEntity->GetCollisionBoundingBox().min.z -
-        distBelow + 1.15;
+    if (mode->posture == "pid_stand")
+    {
+      this->atlasCommandController.SetPIDStand(this->atlas.model);
+      ROS_INFO("set robot configuration done");
     }
-    else
+    else if (mode->posture == "seated")
     {
-      gzwarn << "No entity below robot, or GetEntityBelowPoint "
-             << "returned NULL pointer. Assume ground height = 0.0m\n";
-      // put atlas back
-      atlasPose.pos.z =  1.15;
+      this->atlasCommandController.SetSeatingConfiguration(
+        this->atlas.model);
     }
-
-    // set robot pose and pin it
-    atlasPose.rot.SetFromEuler(0, 0, 0);
-    this->atlas.model->SetLinkWorldPose(atlasPose, this->atlas.pinLink);
-
-    this->atlas.pinJoint = this->AddJoint(this->world,
-                                      this->atlas.model,
-                                      physics::LinkPtr(),
-                                      this->atlas.pinLink,
-                                      "revolute",
-                                      math::Vector3(0, 0, 0),
-                                      math::Vector3(0, 0, 1),
-                                      0.0, 0.0);
-    this->atlas.initialPose = this->atlas.pinLink->GetWorldPose();
-
-    // turning off effect of gravity
-    physics::Link_V links = this->atlas.model->GetLinks();
-    for (unsigned int i = 0; i < links.size(); ++i)
+    else if (mode->posture == "standing")
     {
-      links[i]->SetGravityMode(false);
+      this->atlasCommandController.SetStandingConfiguration(
+        this->atlas.model);
     }
-
-    this->world->SetPaused(paused);
   }
-  else if (_str == "pinned")
-  {
-    this->PinAtlas(false);
+
+  this->robotMode = _str;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::HarnessAtlas()
+{
+  // remove pin
+  if (this->atlas.pinJoint)
+    this->RemoveJoint(this->atlas.pinJoint);
+
+  // raise robot, find ground height, set it down and upright it, then pin it
+  math::Pose atlasPose = this->atlas.pinLink->GetWorldPose();
+
+  // where to raise robot to
+  math::Pose atlasAway = atlasPose + math::Pose(0, 0, 50.0, 0, 0, 0);
+
+  // move robot out of the way
+  this->atlas.model->SetLinkWorldPose(atlasAway, this->atlas.pinLink);
+
+  // where to start down casting ray to check for ground
+  math::Pose rayStart = atlasPose - math::Pose(0, 0, -2.0, 0, 0, 0);
+
+  double distBelow = 0.0;
+  physics::EntityPtr entityBelow;
+  physics::EntityPtr fromEntity = this->atlas.pinLink;
+  std::string objectBelow;
+  fromEntity->GetNearestEntityBelow(distBelow, objectBelow);
+  entityBelow = this->world->GetEntity(objectBelow);
+  gzdbg << fromEntity->GetName() << " "
+        << distBelow << " " << objectBelow << "\n";
+  // if entity below is part of atlas, set it to fromEntity
+  // and keep searching below
+  while (entityBelow && (entityBelow->GetParentModel() ==
+    fromEntity->GetParentModel()))
+  {
+    objectBelow.clear();
+    fromEntity = entityBelow;
+    fromEntity->GetNearestEntityBelow(distBelow, objectBelow);
+    entityBelow = this->world->GetEntity(objectBelow);
+    gzdbg << fromEntity->GetName() << " "
+          << distBelow << " " << objectBelow << "\n";
   }
-  else if (_str == "pinned_with_gravity")
+  if (entityBelow && fromEntity)
   {
-    this->PinAtlas(true);
+    // gzdbg << objectBelow << "\n";
+    // gzdbg << groundHeight << "\n";
+    // gzdbg << groundBB.max.z << "\n";
+    // gzdbg << groundBB.min.z << "\n";
+
+    // slightly above ground and upright
+    // fromEntity->GetCollisionBoundingBox().min.z gives us the
+    // lowest point of atlas robot. Set pin location to 1.15m
+    // above it.
+    atlasPose.pos.z = fromEntity->GetCollisionBoundingBox().min.z -
+      distBelow + 1.15;
   }
-  else if (_str == "nominal")
+  else
   {
-    this->UnpinAtlas();
+    gzwarn << "No entity below robot, or GetEntityBelowPoint "
+           << "returned NULL pointer. Assume ground height = 0.0m\n";
+    // put atlas back
+    atlasPose.pos.z =  1.15;
   }
-  else if (_str == "pid_stand")
-  {
-    // Robot is PID controlled in BDI stand Pose and PINNED.
 
-    // pin robot
-    if (this->atlas.pinJoint)
-      this->RemoveJoint(this->atlas.pinJoint);
-    if (this->vehicleRobotJoint)
-      this->RemoveJoint(this->vehicleRobotJoint);
-    this->atlas.pinJoint = this->AddJoint(this->world,
-                                      this->atlas.model,
-                                      physics::LinkPtr(),
-                                      this->atlas.pinLink,
-                                      "revolute",
-                                      math::Vector3(0, 0, 0),
-                                      math::Vector3(0, 0, 1),
-                                      0.0, 0.0);
-    // turning off effect of gravity
-    this->atlas.model->SetGravityMode(false);
+  // set robot pose and pin it
+  atlasPose.rot.SetFromEuler(0, 0, 0);
+  this->atlas.model->SetLinkWorldPose(atlasPose, this->atlas.pinLink);
 
-    // turn physics off while manipulating things
-    bool physics = this->world->GetEnablePhysicsEngine();
-    bool paused = this->world->IsPaused();
-    this->world->SetPaused(true);
-    this->world->EnablePhysicsEngine(false);
+  this->atlas.pinJoint = this->AddJoint(this->world,
+                                    this->atlas.model,
+                                    physics::LinkPtr(),
+                                    this->atlas.pinLink,
+                                    "revolute",
+                                    math::Vector3(0, 0, 0),
+                                    math::Vector3(0, 0, 1),
+                                    0.0, 0.0);
+  this->atlas.initialPose = this->atlas.pinLink->GetWorldPose();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::LoadRobotModes()
+{
+  // built-in modes, atlas/modes/<name>/... overrides them and
+  // atlas/modes/names adds new ones
+  this->robotModes.clear();
+  RobotMode mode;
+  mode.profile = CollisionProfiles::NoProfile;
+
+  // gravity disabled for the robot
+  mode.name = "no_gravity";
+  mode.pin = PIN_NONE;
+  mode.gravity = false;
+  mode.kinematic = false;
+  this->robotModes.push_back(mode);
+
+  // same as no_gravity except for r_foot and l_foot links
+  mode.name = "feet";
+  mode.gravityExcept.push_back("l_foot");
+  mode.gravityExcept.push_back("r_foot");
+  this->robotModes.push_back(mode);
+  mode.gravityExcept.clear();
+
+  // lowered to the ground, upright and pinned by the pelvis
+  mode.name = "harnessed";
+  mode.pin = PIN_HARNESS;
+  mode.kinematic = true;
+  this->robotModes.push_back(mode);
+
+  // pinned to inertial world by the pelvis
+  mode.name = "pinned";
+  mode.pin = PIN_CURRENT;
+  mode.collisionProfile = "warp";
+  this->robotModes.push_back(mode);
+
+  mode.name = "pinned_with_gravity";
+  mode.gravity = true;
+  this->robotModes.push_back(mode);
+
+  // PID controlled in BDI stand pose and pinned
+  mode.name = "pid_stand";
+  mode.gravity = false;
+  mode.collisionProfile.clear();
+  mode.posture = "pid_stand";
+  this->robotModes.push_back(mode);
+
+  // nominal "normal" physics
+  mode.name = "nominal";
+  mode.pin = PIN_NONE;
+  mode.gravity = true;
+  mode.kinematic = false;
+  mode.collisionProfile = "nominal";
+  mode.posture.clear();
+  this->robotModes.push_back(mode);
+
+  std::vector<std::string> names;
+  if (this->rosNode)
+    this->rosNode->getParam("atlas/modes/names", names);
+  for (unsigned int i = 0; i < names.size(); ++i)
+  {
+    bool found = false;
+    for (unsigned int j = 0; j < this->robotModes.size() && !found; ++j)
+      found = (this->robotModes[j].name == names[i]);
+    if (found)
+      continue;
+
+    // new modes start out like nominal without touching the collisions
+    mode.name = names[i];
+    mode.collisionProfile.clear();
+    this->robotModes.push_back(mode);
+  }
+
+  physics::Link_V links = this->atlas.model->GetLinks();
+  for (std::vector<RobotMode>::iterator it = this->robotModes.begin();
+       it != this->robotModes.end(); ++it)
+  {
+    if (this->rosNode)
+    {
+      std::string ns = "atlas/modes/" + it->name + "/";
+      std::string pin;
+      if (this->rosNode->getParam(ns + "pin", pin))
+      {
+        if (pin == "none")
+          it->pin = PIN_NONE;
+        else if (pin == "current")
+          it->pin = PIN_CURRENT;
+        else if (pin == "harness")
+          it->pin = PIN_HARNESS;
+        else
+          ROS_WARN("Unknown pin [%s] for robot mode [%s].", pin.c_str(),
+                   it->name.c_str());
+      }
+      this->rosNode->getParam(ns + "gravity", it->gravity);
+      this->rosNode->getParam(ns + "gravity_except", it->gravityExcept);
+      this->rosNode->getParam(ns + "collision_profile",
+                              it->collisionProfile);
+      this->rosNode->getParam(ns + "kinematic", it->kinematic);
+      this->rosNode->getParam(ns + "posture", it->posture);
+      this->rosNode->getParam(ns + "gains", it->gains);
+    }
 
-    // set robot configuration
-    this->atlasCommandController.SetPIDStand(this->atlas.model);
-    /// FIXME: uncomment sleep below and AtlasSimInterface fails to STAND, why?
-    // gazebo::common::Time::Sleep(gazebo::common::Time(1.0));
-    ROS_INFO("set robot configuration done");
+    it->linkGravity.assign(links.size(), it->gravity);
+    for (unsigned int i = 0; i < links.size(); ++i)
+    {
+      if (std::find(it->gravityExcept.begin(), it->gravityExcept.end(),
+            links[i]->GetName()) != it->gravityExcept.end())
+        it->linkGravity[i] = !it->gravity;
+    }
 
-    this->world->EnablePhysicsEngine(physics);
-    this->world->SetPaused(paused);
-    // this->atlasCommandController.SetBDIFREEZE();
-  }
-  else
-  {
-    ROS_INFO("available modes:no_gravity, feet, pinned, nominal");
+    it->profile = CollisionProfiles::NoProfile;
+    if (!it->collisionProfile.empty())
+    {
+      it->profile = this->collisionProfiles.Find(it->collisionProfile);
+      if (it->profile == CollisionProfiles::NoProfile)
+      {
+        ROS_WARN("Unknown collision profile [%s] for robot mode [%s].",
+                 it->collisionProfile.c_str(), it->name.c_str());
+      }
+    }
+
+    if (!it->posture.empty() && it->posture != "pid_stand" &&
+        it->posture != "seated" && it->posture != "standing")
+    {
+      ROS_WARN("Unknown posture [%s] for robot mode [%s].",
+               it->posture.c_str(), it->name.c_str());
+    }
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
 void VRCPlugin::StepDataToTwist(
   const atlas_msgs::AtlasBehaviorStepData & _step,
   double _dt,
@@ -381,7 +662,7 @@ void VRCPlugin::StepDataToTwist(
     (foot_idx == 0) ? "l_foot" : "r_foot");
   if (!foot_link)
   {
-    ROS_ERROR("Couldn't find Atlas's foot link when faking walking.");
+    VIGIR_LOG_ERROR("Couldn't find Atlas's foot link when faking walking.");
     return;
   }
   math::Pose current_foot_pose = foot_link->GetWorldPose();
@@ -447,13 +728,14 @@ void VRCPlugin::StepDataToTwist(
 void VRCPlugin::SetFakeASIC(
   const atlas_msgs::AtlasSimInterfaceCommand::ConstPtr &_asic)
 {
-  // Disable the real BDI behavior library
-  atlas_msgs::AtlasSimInterfaceCommand ac;
+  // Disable the real BDI behavior library, k_effort is only filled on the
+  // first command
+  atlas_msgs::AtlasSimInterfaceCommand &ac = this->atlas.userBehaviorCommand;
   ac.header.stamp = ros::Time::now();
   ac.behavior = ac.USER;
-  for (size_t i=0; i<this->atlasCommandController.jointNames.size(); i++)
-    ac.k_effort.push_back(255);
-  this->atlasCommandController.pubAtlasSimInterfaceCommand.publish(ac);
+  ac.k_effort.resize(this->atlasCommandController.jointNames.size(), 255);
+  if (this->atlasCommandController.pubAtlasSimInterfaceCommand)
+    this->atlasCommandController.pubAtlasSimInterfaceCommand.publish(ac);
 
   geometry_msgs::Twist::Ptr zero_vel(new geometry_msgs::Twist);
   if (_asic->behavior == atlas_msgs::AtlasSimInterfaceCommand::STAND)
@@ -470,23 +752,24 @@ void VRCPlugin::SetFakeASIC(
   else if (_asic->behavior == atlas_msgs::AtlasSimInterfaceCommand::FREEZE)
   {
     // We fake FREEZE by doing PID around current joint positions.
-    if (!this->atlasCommandController.js_valid)
+    sensor_msgs::JointState::ConstPtr js =
+      this->atlasCommandController.GetLastJointStates();
+    if (!js)
     {
       ROS_WARN("FREEZE commanded, but no valid joint state yet,"
                "so I can't set PID position goals.");
       return;
     }
-    ROS_ASSERT(this->atlasCommandController.js->position.size() ==
+    ROS_ASSERT(js->position.size() ==
       this->atlasCommandController.ac.position.size());
-    for (size_t i=0; i < this->atlasCommandController.js->position.size(); i++)
+    for (size_t i=0; i < js->position.size(); i++)
     {
       // Here we just set desired positions.
       // We assume that everything else in
       // this->atlasCommandController->ac was set properly in
       // VRCPlugin::AtlasCommandController::InitModel().
       this->atlasCommandController.ac.k_effort[i] = 255;
-      this->atlasCommandController.ac.position[i] =
-        this->atlasCommandController.js->position[i];
+      this->atlasCommandController.ac.position[i] = js->position[i];
     }
     this->atlasCommandController.pubAtlasCommand.publish(
       this->atlasCommandController.ac);
@@ -521,7 +804,7 @@ void VRCPlugin::SetFakeASIC(
     this->atlas.currentStepIndex = _asic->walk_params.step_queue[0].step_index;
     this->atlas.lastStepIndex =
       _asic->walk_params.step_queue[step_idx].step_index;
-    this->SetFeetCollide("none");
+    this->SetCollisionProfile(this->warpProfile);
     this->SetRobotCmdVel(cmd_vel, dt);
   }
   else if (_asic->behavior == atlas_msgs::AtlasSimInterfaceCommand::STEP)
@@ -540,7 +823,7 @@ void VRCPlugin::SetFakeASIC(
     this->StepDataToTwist(_asic->step_params.desired_step, dt, cmd_vel);
     this->atlas.currentStepIndex = _asic->step_params.desired_step.step_index;
     this->atlas.lastStepIndex = _asic->step_params.desired_step.step_index;
-    this->SetFeetCollide("none");
+    this->SetCollisionProfile(this->warpProfile);
     this->SetRobotCmdVel(cmd_vel, dt);
   }
   else if (_asic->behavior == atlas_msgs::AtlasSimInterfaceCommand::MANIPULATE)
@@ -561,8 +844,9 @@ void VRCPlugin::SetFakeASIC(
 ////////////////////////////////////////////////////////////////////////////////
 void VRCPlugin::SetRobotCmdVelTopic(const geometry_msgs::Twist::ConstPtr &_cmd)
 {
-  // hard code timeout to 0.1 seconds
-  this->SetRobotCmdVel(_cmd, this->cmdVelTopicTimeout);
+  // the cmd_vel timeout of the config applied this tick
+  boost::shared_ptr<const Config> latest = boost::atomic_load(&this->config);
+  this->SetRobotCmdVel(_cmd, latest->cmd_vel_timeout);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -597,17 +881,8 @@ void VRCPlugin::SetRobotPose(const geometry_msgs::Pose::ConstPtr &_pose)
                                 _pose->position.z), q);
 
   // turn physics off during SetWorldPose
-  {
-    bool physics = this->world->GetEnablePhysicsEngine();
-    bool paused = this->world->IsPaused();
-    this->world->SetPaused(true);
-    this->world->EnablePhysicsEngine(false);
-
-    this->atlas.model->SetWorldPose(pose);
-
-    this->world->EnablePhysicsEngine(physics);
-    this->world->SetPaused(paused);
-  }
+  WorldEdit edit(this);
+  this->atlas.model->SetWorldPose(pose);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -629,6 +904,8 @@ void VRCPlugin::RobotGrabFireHose(const geometry_msgs::Pose::ConstPtr &_cmd)
     physics::LinkPtr gripper = this->atlas.model->GetLink(gripperName);
     if (gripper)
     {
+      WorldEdit edit(this);
+
       // teleports the object being attached together
       pose = pose + relPose + gripper->GetWorldPose();
       this->drcFireHose.fireHoseModel->SetLinkWorldPose(pose,
@@ -649,7 +926,145 @@ void VRCPlugin::RobotGrabFireHose(const geometry_msgs::Pose::ConstPtr &_cmd)
 ////////////////////////////////////////////////////////////////////////////////
 void VRCPlugin::RobotReleaseLink(const geometry_msgs::Pose::ConstPtr &/*_cmd*/)
 {
+  WorldEdit edit(this);
   this->RemoveJoint(this->grabJoint);
+  this->RemoveJoint(this->handGrabJoints[0]);
+  this->RemoveJoint(this->handGrabJoints[1]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::RobotGrabTopic(const std_msgs::String::ConstPtr &_cmd)
+{
+  std::istringstream fields(_cmd->data);
+  std::string hand, target;
+  fields >> hand >> target;
+  this->RobotGrab(hand, target);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool VRCPlugin::RobotGrab(const std::string &_hand,
+                          const std::string &_target)
+{
+  int side;
+  if (_hand == "left" || _hand == "l_hand")
+    side = 0;
+  else if (_hand == "right" || _hand == "r_hand")
+    side = 1;
+  else
+  {
+    ROS_WARN("RobotGrab: unknown hand [%s], use left or right.",
+             _hand.c_str());
+    return false;
+  }
+
+  physics::LinkPtr handLink;
+  if (this->atlas.model)
+    handLink = this->atlas.model->GetLink(side == 0 ? "l_hand" : "r_hand");
+  if (!handLink)
+  {
+    ROS_WARN("RobotGrab: atlas has no [%s] link.",
+             side == 0 ? "l_hand" : "r_hand");
+    return false;
+  }
+
+  physics::LinkPtr target;
+  if (!_target.empty())
+  {
+    // "model::link" or just "model"
+    size_t sep = _target.find("::");
+    physics::ModelPtr model = this->world->GetModel(_target.substr(0, sep));
+    if (model)
+    {
+      target = (sep == std::string::npos) ? model->GetLink() :
+        model->GetLink(_target.substr(sep + 2));
+    }
+  }
+  else
+  {
+    target = this->grabBVH.Nearest(handLink->GetWorldPose().pos,
+      this->grabMaxDistance,
+      boost::bind(&VRCPlugin::IsGraspable, this, _1));
+  }
+
+  if (!target)
+  {
+    if (_target.empty())
+    {
+      ROS_WARN("RobotGrab: nothing to grab within %f m of the %s hand.",
+               this->grabMaxDistance, _hand.c_str());
+    }
+    else
+      ROS_WARN("RobotGrab: link [%s] not found.", _target.c_str());
+    return false;
+  }
+
+  // weld the link where it is
+  WorldEdit edit(this);
+  this->RemoveJoint(this->handGrabJoints[side]);
+  this->handGrabJoints[side] = this->AddJoint(this->world, this->atlas.model,
+                                              handLink, target,
+                                              "revolute",
+                                              math::Vector3(0, 0, 0),
+                                              math::Vector3(0, 0, 1),
+                                              0.0, 0.0);
+  ROS_INFO("RobotGrab: %s hand grabbed [%s].", _hand.c_str(),
+           target->GetScopedName().c_str());
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool VRCPlugin::IsGraspable(const physics::LinkPtr &_link) const
+{
+  for (unsigned int i = 0; i < 2; ++i)
+  {
+    if (this->handGrabJoints[i] &&
+        this->handGrabJoints[i]->GetChild() == _link)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::UpdateGrabBVH()
+{
+  // the model count alone misses a delete and a spawn between two ticks,
+  // ids are never reused
+  unsigned int modelCount = this->world->GetModelCount();
+  bool changed = modelCount != this->grabBVHModels.size();
+  for (unsigned int i = 0; i < modelCount && !changed; ++i)
+  {
+    physics::ModelPtr model = this->world->GetModel(i);
+    changed = !model ||
+      model->GetId() != this->grabBVHModels[i].first ||
+      model->IsStatic() != this->grabBVHModels[i].second;
+  }
+  if (!changed)
+  {
+    this->grabBVH.Refit();
+    return;
+  }
+
+  physics::Link_V links;
+  this->grabBVHModels.clear();
+  for (unsigned int i = 0; i < modelCount; ++i)
+  {
+    physics::ModelPtr model = this->world->GetModel(i);
+    if (!model)
+    {
+      // rebuilt again next tick
+      this->grabBVHModels.push_back(std::make_pair(0u, false));
+      continue;
+    }
+    this->grabBVHModels.push_back(
+      std::make_pair(model->GetId(), model->IsStatic()));
+    if (model == this->atlas.model || model->IsStatic())
+      continue;
+    physics::Link_V modelLinks = model->GetLinks();
+    links.insert(links.end(), modelLinks.begin(), modelLinks.end());
+  }
+  this->grabBVH.Build(links);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -668,32 +1083,39 @@ physics::JointPtr VRCPlugin::AddJoint(physics::WorldPtr _world,
   if (_world->GetPhysicsEngine()->GetType() == "ode" ||
       _world->GetPhysicsEngine()->GetType() == "bullet")
   {
-    joint = _world->GetPhysicsEngine()->CreateJoint(
-      _type, _model);
+    // reuse the pooled joint of this link pair, it is created, named and
+    // loaded the first time only
+    bool loaded = false;
+    joint = this->jointPool.Acquire(_world->GetPhysicsEngine(), _model,
+                                    _type, _link1, _link2, loaded);
     joint->Attach(_link1, _link2);
-    // load adds the joint to a vector of shared pointers kept
-    // in parent and child links, preventing joint from being destroyed.
-    joint->Load(_link1, _link2, math::Pose(_anchor, math::Quaternion()));
-    joint->SetAxis(0, _axis);
-    joint->SetHighStop(0, _upper);
-    joint->SetLowStop(0, _lower);
-
-    if (_link1)
-      joint->SetName(_link1->GetName() + std::string("_") +
-                                _link2->GetName() + std::string("_joint"));
+    if (loaded)
+      this->ReseatJoint(joint, _anchor, _axis);
     else
-      joint->SetName(std::string("world_") +
-                                _link2->GetName() + std::string("_joint"));
-    joint->Init();
+    {
+      // load adds the joint to a vector of shared pointers kept
+      // in parent and child links, preventing joint from being destroyed.
+      joint->Load(_link1, _link2, math::Pose(_anchor, math::Quaternion()));
+      joint->SetAxis(0, _axis);
+      joint->SetHighStop(0, _upper);
+      joint->SetLowStop(0, _lower);
+      joint->Init();
+    }
 
 
     // disable collision between the link pair
     if (_disableCollision)
     {
       if (_link1)
-        _link1->SetCollideMode("fixed");
+      {
+        this->collisionProfiles.OverrideLink(_link1,
+          CollisionProfiles::FixedBit, ~CollisionProfiles::FixedBit);
+      }
       if (_link2)
-        _link2->SetCollideMode("fixed");
+      {
+        this->collisionProfiles.OverrideLink(_link2,
+          CollisionProfiles::FixedBit, ~CollisionProfiles::FixedBit);
+      }
     }
   }
   else if (_world->GetPhysicsEngine()->GetType() == "simbody" ||
@@ -726,113 +1148,225 @@ void VRCPlugin::RobotEnterCar(const geometry_msgs::Pose::ConstPtr &_pose)
   math::Pose pose(math::Vector3(_pose->position.x,
                                 _pose->position.y,
                                 _pose->position.z), q);
+
+  // turn physics off while manipulating things
+  WorldEdit edit(this);
+  this->vehicleRobotJointReleaseTime = -1.0;
+  this->SetKinematicSubtrees(false);
+  this->robotMode.clear();
+
   if (this->atlas.pinJoint)
     this->RemoveJoint(this->atlas.pinJoint);
 
-  if (this->vehicleRobotJoint)
-    this->RemoveJoint(this->vehicleRobotJoint);
-
-  math::Vector3 atlasVehicleRelPos = math::Vector3(-0.06, 0.3, 1.28);
+  this->UnweldRobotFromVehicle();
 
   // hardcoded offset of the robot when it's seated in the vehicle driver seat.
-  this->atlas.vehicleRelPose = math::Pose(atlasVehicleRelPos,
-                                              math::Quaternion());
-
-  // turn physics off while manipulating things
-  bool physics = this->world->GetEnablePhysicsEngine();
-  bool paused = this->world->IsPaused();
-  this->world->SetPaused(true);
-  this->world->EnablePhysicsEngine(false);
+  this->atlas.vehicleRelPose = math::Pose(math::Vector3(-0.06, 0.3, 1.28),
+                                          math::Quaternion());
 
   // set robot configuration
   this->atlasCommandController.SetSeatingConfiguration(this->atlas.model);
-  ros::spinOnce();
-  // give some time for controllers to settle
-  // \todo: use joint state subscriber to check if goal is obtained
-  gazebo::common::Time::MSleep(1000);
   ROS_INFO("set robot configuration done");
 
-  this->world->EnablePhysicsEngine(physics);
-  this->world->SetPaused(paused);
-
-  this->atlas.model->SetLinkWorldPose(pose + this->atlas.vehicleRelPose + this->drcVehicle.model->GetWorldPose(), this->atlas.pinLink);
-
-  if (!this->vehicleRobotJoint)
-    this->vehicleRobotJoint = this->AddJoint(this->world,
-                                       this->drcVehicle.model,
-                                       this->drcVehicle.seatLink,
-                                       this->atlas.pinLink,
-                                       "revolute",
-                                       math::Vector3(0, 0, 0),
-                                       math::Vector3(0, 0, 1),
-                                       0.0, 0.0);
-
-  // this->atlas.vehicleRelPose = math::Pose(math::Vector3(0.52, 0.5, 1.27),
-  this->atlas.vehicleRelPose = math::Pose(atlasVehicleRelPos,
-      math::Quaternion());
-
-  this->RemoveJoint(this->vehicleRobotJoint);
-
   this->atlas.model->SetLinkWorldPose(pose +
     this->atlas.vehicleRelPose + this->drcVehicle.model->GetWorldPose(),
     this->atlas.pinLink);
 
-  if (!this->vehicleRobotJoint)
-    this->vehicleRobotJoint = this->AddJoint(this->world,
-                                       this->drcVehicle.model,
-                                       this->drcVehicle.seatLink,
-                                       this->atlas.pinLink,
-                                       "revolute",
-                                       math::Vector3(0, 0, 0),
-                                       math::Vector3(0, 0, 1),
-                                       0.0, 0.0);
-
-  if (this->vehicleRobotJoint)
-    this->RemoveJoint(this->vehicleRobotJoint);
+  if (this->drcVehicle.weldRobot)
+    this->WeldRobotToVehicle();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void VRCPlugin::RobotExitCar(const geometry_msgs::Pose::ConstPtr &_pose)
+void VRCPlugin::WeldRobotToVehicle()
 {
-  // Check if drcVehicle.model is loaded
-  if (!this->drcVehicle.model)
-  {
-    ROS_ERROR("drc_vehicle model not found, cannot exit car.");
-    return;
+  WorldEdit edit(this);
+  this->UnweldRobotFromVehicle();
+
+  this->vehicleRobotJoint = this->AddJoint(this->world,
+                                     this->drcVehicle.model,
+                                     this->drcVehicle.seatLink,
+                                     this->atlas.pinLink,
+                                     "revolute",
+                                     math::Vector3(0, 0, 0),
+                                     math::Vector3(0, 0, 1),
+                                     0.0, 0.0);
+
+  if (this->drcVehicle.disableCabCollision)
+    this->SetCollisionProfile(this->seatedProfile);
+
+  if (this->drcVehicle.freezeLegs)
+  {
+    // lock the legs in the seated posture.  Kinematic links wouldn't
+    // follow the moving vehicle, so the joint limits are clamped instead.
+    physics::Joint_V joints = this->atlas.model->GetJoints();
+    for (unsigned int i = 0; i < joints.size(); ++i)
+    {
+      if (joints[i]->GetName().find("_leg_") == std::string::npos)
+        continue;
+
+      SavedJointStops saved;
+      saved.joint = joints[i];
+      saved.high = joints[i]->GetHighStop(0);
+      saved.low = joints[i]->GetLowStop(0);
+      this->savedLegStops.push_back(saved);
+
+      math::Angle angle = joints[i]->GetAngle(0);
+      joints[i]->SetHighStop(0, angle);
+      joints[i]->SetLowStop(0, angle);
+    }
   }
-  math::Quaternion q(_pose->orientation.w, _pose->orientation.x,
-                    _pose->orientation.y, _pose->orientation.z);
-  q.Normalize();
-  math::Pose pose(math::Vector3(_pose->position.x,
-                                _pose->position.y,
-                                _pose->position.z), q);
-
-  if (this->atlas.pinJoint)
-    this->RemoveJoint(this->atlas.pinJoint);
+}
 
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::UnweldRobotFromVehicle()
+{
   if (this->vehicleRobotJoint)
     this->RemoveJoint(this->vehicleRobotJoint);
 
-  // hardcoded offset of the robot when it's standing next to the vehicle.
-  this->atlas.vehicleRelPose = math::Pose(0.52, 1.7, 1.20, 0, 0, 0);
+  if (this->collisionProfiles.Active() == this->seatedProfile)
+    this->SetCollisionProfile(this->nominalProfile);
 
-  // turn physics off while manipulating things
-  bool physics = this->world->GetEnablePhysicsEngine();
-  bool paused = this->world->IsPaused();
-  this->world->SetPaused(true);
-  this->world->EnablePhysicsEngine(false);
-  // set robot configuration
-  //this->atlasCommandController.SetStandingConfiguration(this->atlas.model);
+  for (unsigned int i = 0; i < this->savedLegStops.size(); ++i)
+  {
+    const SavedJointStops &saved = this->savedLegStops[i];
+    saved.joint->SetHighStop(0, saved.high);
+    saved.joint->SetLowStop(0, saved.low);
+  }
+  this->savedLegStops.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::LoadKinematicSubtrees()
+{
+  this->kinematicJoints.clear();
+  this->kinematicNames.clear();
+  this->kinematicLinks.clear();
+  this->kinematicPositions.clear();
+
+  std::vector<std::string> prefixes;
+  if (!this->rosNode ||
+      !this->rosNode->getParam("atlas/kinematic_subtrees", prefixes) ||
+      prefixes.empty())
+    return;
+
+  const std::vector<std::string> &names =
+    this->atlasCommandController.jointNames;
+  for (unsigned int i = 0; i < names.size(); ++i)
+  {
+    physics::JointPtr joint = this->atlasCommandController.joints[i];
+    if (!joint)
+      continue;
+
+    for (unsigned int p = 0; p < prefixes.size(); ++p)
+    {
+      if (names[i].compare(0, prefixes[p].size(), prefixes[p]) != 0)
+        continue;
+
+      this->kinematicJoints.push_back(i);
+      this->kinematicNames.push_back(this->atlas.model->GetName() + "::" +
+                                     names[i]);
+      this->kinematicPositions[this->kinematicNames.back()] =
+        joint->GetAngle(0).Radian();
+      physics::LinkPtr child = joint->GetChild();
+      if (child && std::find(this->kinematicLinks.begin(),
+            this->kinematicLinks.end(), child) == this->kinematicLinks.end())
+        this->kinematicLinks.push_back(child);
+      break;
+    }
+  }
+
+  ROS_INFO("%lu atlas joints are kinematic while the robot is pinned.",
+           static_cast<unsigned long>(this->kinematicJoints.size()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::SetKinematicSubtrees(bool _enable)
+{
+  if (_enable == this->kinematicSubtreesEnabled ||
+      this->kinematicLinks.empty())
+    return;
+
+  WorldEdit edit(this);
+  this->kinematicSubtreesEnabled = _enable;
+  for (unsigned int i = 0; i < this->kinematicLinks.size(); ++i)
+  {
+    // kinematic links keep their velocity, stop them first
+    this->kinematicLinks[i]->ResetPhysicsStates();
+    this->kinematicLinks[i]->SetKinematic(_enable);
+  }
+
+  // start from the current angles and move to the current command on the
+  // next update
+  for (unsigned int i = 0; i < this->kinematicJoints.size(); ++i)
+  {
+    unsigned int j = this->kinematicJoints[i];
+    this->kinematicPositions[this->kinematicNames[i]] =
+      this->atlasCommandController.joints[j]->GetAngle(0).Radian();
+  }
+  this->kinematicCommand.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::UpdateKinematicSubtrees()
+{
+  atlas_msgs::AtlasCommand::ConstPtr command =
+    this->atlasCommandController.GetLastCommand();
+  if (!command || command == this->kinematicCommand)
+    return;
+  this->kinematicCommand = command;
+
+  bool changed = false;
+  for (unsigned int i = 0; i < this->kinematicJoints.size(); ++i)
+  {
+    unsigned int j = this->kinematicJoints[i];
+    if (j >= command->position.size())
+      continue;
+    double &position = this->kinematicPositions[this->kinematicNames[i]];
+    if (position != command->position[j])
+    {
+      position = command->position[j];
+      changed = true;
+    }
+  }
+
+  if (changed)
+    this->atlas.model->SetJointPositions(this->kinematicPositions);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::RobotExitCar(const geometry_msgs::Pose::ConstPtr &_pose)
+{
+  // Check if drcVehicle.model is loaded
+  if (!this->drcVehicle.model)
+  {
+    ROS_ERROR("drc_vehicle model not found, cannot exit car.");
+    return;
+  }
+  math::Quaternion q(_pose->orientation.w, _pose->orientation.x,
+                    _pose->orientation.y, _pose->orientation.z);
+  q.Normalize();
+  math::Pose pose(math::Vector3(_pose->position.x,
+                                _pose->position.y,
+                                _pose->position.z), q);
+
+  // turn physics off while manipulating things
+  WorldEdit edit(this);
+  this->SetKinematicSubtrees(false);
+  this->robotMode.clear();
+
+  if (this->atlas.pinJoint)
+    this->RemoveJoint(this->atlas.pinJoint);
+
+  this->UnweldRobotFromVehicle();
+
+  // hardcoded offset of the robot when it's standing next to the vehicle.
+  this->atlas.vehicleRelPose = math::Pose(0.52, 1.7, 1.20, 0, 0, 0);
+
+  // set robot configuration
+  //this->atlasCommandController.SetStandingConfiguration(this->atlas.model);
   this->atlasCommandController.SetPIDStand(this->atlas.model);
-  ros::spinOnce();
-  // give some time for controllers to settle
-  // \todo: use joint state subscriber to check if goal is obtained
-  gazebo::common::Time::MSleep(1000);
   ROS_INFO("set configuration done");
 
-  this->world->EnablePhysicsEngine(physics);
-  this->world->SetPaused(paused);
-
   // move model to new pose
   this->atlas.model->SetLinkWorldPose(pose +
     this->atlas.vehicleRelPose + this->drcVehicle.model->GetWorldPose(),
@@ -847,10 +1381,11 @@ void VRCPlugin::RobotExitCar(const geometry_msgs::Pose::ConstPtr &_pose)
                                        math::Vector3(0, 0, 0),
                                        math::Vector3(0, 0, 1),
                                        0.0, 0.0);
-  gazebo::common::Time::MSleep(5000);
 
-  if (this->vehicleRobotJoint)
-    this->RemoveJoint(this->vehicleRobotJoint);
+  // hold the robot next to the vehicle while it settles, UpdateStates
+  // removes the joint
+  this->vehicleRobotJointReleaseTime =
+    this->world->GetSimTime().Double() + 5.0;
 }
 
 
@@ -858,22 +1393,249 @@ void VRCPlugin::RobotExitCar(const geometry_msgs::Pose::ConstPtr &_pose)
 // remove a joint
 void VRCPlugin::RemoveJoint(physics::JointPtr &_joint)
 {
-  bool paused = this->world->IsPaused();
-  this->world->SetPaused(true);
   if (_joint)
   {
+    WorldEdit edit(this);
+
     // reenable collision between the link pair
     physics::LinkPtr parent = _joint->GetParent();
     physics::LinkPtr child = _joint->GetChild();
     if (parent)
-      parent->SetCollideMode("all");
+      this->collisionProfiles.RestoreLink(parent);
     if (child)
-      child->SetCollideMode("all");
+      this->collisionProfiles.RestoreLink(child);
 
-    _joint->Detach();
+    this->jointPool.Release(_joint);
     _joint.reset();
   }
-  this->world->SetPaused(paused);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::ReseatJoint(const physics::JointPtr &_joint,
+                            const math::Vector3 &_anchor,
+                            const math::Vector3 &_axis)
+{
+  // the anchor and the zero angle are kept relative to where the links
+  // were when they were last set, set both at the current child pose
+  physics::LinkPtr child = _joint->GetChild();
+  _joint->SetAnchor(0, (math::Pose(_anchor, math::Quaternion()) +
+                        child->GetWorldPose()).pos);
+  _joint->SetAxis(0, _axis);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::ReserveJoints()
+{
+  physics::PhysicsEnginePtr engine = this->world->GetPhysicsEngine();
+  if (engine->GetType() != "ode" && engine->GetType() != "bullet")
+    return;
+
+  // atlas pin
+  this->jointPool.Reserve(engine, this->atlas.model, "revolute",
+                          physics::LinkPtr(), this->atlas.pinLink);
+
+  // robot in the driver seat
+  if (this->drcVehicle.model && this->drcVehicle.seatLink)
+  {
+    this->jointPool.Reserve(engine, this->drcVehicle.model, "revolute",
+                            this->drcVehicle.seatLink, this->atlas.pinLink);
+  }
+
+  if (this->drcFireHose.fireHoseModel && this->drcFireHose.couplingLink)
+  {
+    // hose held by the right hand
+    physics::LinkPtr gripper = this->atlas.model->GetLink("r_hand");
+    if (gripper)
+    {
+      this->jointPool.Reserve(engine, this->atlas.model, "revolute",
+                              gripper, this->drcFireHose.couplingLink);
+    }
+
+    // hose threaded onto the standpipe
+    if (this->drcFireHose.spoutLink)
+    {
+      this->jointPool.Reserve(engine, this->drcFireHose.fireHoseModel,
+                              "screw", this->drcFireHose.spoutLink,
+                              this->drcFireHose.couplingLink);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::JointPool::Reserve(physics::PhysicsEnginePtr _engine,
+                                   physics::ModelPtr _model,
+                                   const std::string &_type,
+                                   physics::LinkPtr _parent,
+                                   physics::LinkPtr _child)
+{
+  if (this->Find(_type, _parent, _child, false) == this->entries.size())
+    this->Create(_engine, _model, _type, _parent, _child);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+physics::JointPtr VRCPlugin::JointPool::Acquire(
+  physics::PhysicsEnginePtr _engine, physics::ModelPtr _model,
+  const std::string &_type, physics::LinkPtr _parent, physics::LinkPtr _child,
+  bool &_loaded)
+{
+  size_t index = this->Find(_type, _parent, _child, true);
+  if (index == this->entries.size())
+    index = this->Create(_engine, _model, _type, _parent, _child);
+
+  Entry &entry = this->entries[index];
+  _loaded = entry.loaded;
+  entry.loaded = true;
+  entry.inUse = true;
+  return entry.joint;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::JointPool::Release(const physics::JointPtr &_joint)
+{
+  // the joint stays loaded, the next AddJoint of the link pair only
+  // attaches it again
+  _joint->Detach();
+
+  for (std::vector<Entry>::iterator it = this->entries.begin();
+       it != this->entries.end(); ++it)
+  {
+    if (it->joint == _joint)
+    {
+      it->inUse = false;
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t VRCPlugin::JointPool::Create(physics::PhysicsEnginePtr _engine,
+                                    physics::ModelPtr _model,
+                                    const std::string &_type,
+                                    physics::LinkPtr _parent,
+                                    physics::LinkPtr _child)
+{
+  this->Prune();
+
+  Entry entry;
+  entry.type = _type;
+  entry.world = !_parent;
+  entry.parent = _parent;
+  if (_parent)
+    entry.parentModel = _parent->GetModel();
+  entry.child = _child;
+  entry.childModel = _child->GetModel();
+  entry.joint = _engine->CreateJoint(_type, _model);
+  if (_parent)
+    entry.joint->SetName(_parent->GetName() + "_" + _child->GetName() +
+                         "_joint");
+  else
+    entry.joint->SetName("world_" + _child->GetName() + "_joint");
+  entry.loaded = false;
+  entry.inUse = false;
+
+  this->entries.push_back(entry);
+  return this->entries.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::JointPool::Prune()
+{
+  // forget the joints of deleted links and models, the joint holds its
+  // model and would keep it alive
+  for (size_t i = 0; i < this->entries.size();)
+  {
+    const Entry &entry = this->entries[i];
+    if (entry.child.expired() || entry.childModel.expired() ||
+        (!entry.world &&
+         (entry.parent.expired() || entry.parentModel.expired())))
+    {
+      this->Erase(i);
+    }
+    else
+      ++i;
+  }
+
+  // evict the oldest idle joints, attached ones stay
+  for (size_t i = 0;
+       this->entries.size() >= MaxEntries && i < this->entries.size();)
+  {
+    if (this->entries[i].inUse)
+      ++i;
+    else
+      this->Erase(i);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::JointPool::Erase(size_t _index)
+{
+  // drop the references load added to the links
+  const Entry &entry = this->entries[_index];
+  if (entry.loaded)
+  {
+    physics::LinkPtr parent = entry.parent.lock();
+    physics::LinkPtr child = entry.child.lock();
+    if (parent)
+      parent->RemoveChildJoint(entry.joint->GetName());
+    if (child)
+      child->RemoveParentJoint(entry.joint->GetName());
+  }
+  this->entries.erase(this->entries.begin() + _index);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t VRCPlugin::JointPool::Find(const std::string &_type,
+                                  const physics::LinkPtr &_parent,
+                                  const physics::LinkPtr &_child,
+                                  bool _idleOnly) const
+{
+  for (size_t i = 0; i < this->entries.size(); ++i)
+  {
+    const Entry &entry = this->entries[i];
+    if ((!_idleOnly || !entry.inUse) && entry.type == _type &&
+        entry.parent.lock() == _parent && entry.child.lock() == _child)
+    {
+      return i;
+    }
+  }
+  return this->entries.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::BeginWorldEdit(bool _deferred)
+{
+  if (_deferred)
+  {
+    ++this->worldEditDeferred;
+    return;
+  }
+
+  ++this->worldEditDepth;
+  if (!this->worldEditActive)
+  {
+    this->worldEditPaused = this->world->IsPaused();
+    this->worldEditPhysics = this->world->GetEnablePhysicsEngine();
+    this->world->SetPaused(true);
+    this->world->EnablePhysicsEngine(false);
+    this->worldEditActive = true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::EndWorldEdit(bool _deferred)
+{
+  if (_deferred)
+    --this->worldEditDeferred;
+  else
+    --this->worldEditDepth;
+
+  if (this->worldEditActive && this->worldEditDepth == 0 &&
+      this->worldEditDeferred == 0)
+  {
+    this->world->EnablePhysicsEngine(this->worldEditPhysics);
+    this->world->SetPaused(this->worldEditPaused);
+    this->worldEditActive = false;
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -891,15 +1653,15 @@ void VRCPlugin::Teleport(const physics::LinkPtr &_pinLink,
                          physics::JointPtr &_pinJoint,
                          const math::Pose &_pose)
 {
-  // pause, break joint, update pose, create new joint, unpause
-  bool p = this->world->IsPaused();
-  bool e = this->world->GetEnablePhysicsEngine();
-  this->world->EnablePhysicsEngine(false);
-  this->world->SetPaused(true);
-  if (_pinJoint)
-    this->RemoveJoint(_pinJoint);
+  // pause, update pose, re-seat the pin joint (or create it), unpause.
+  // the pin joint stays attached, removing and adding it again every
+  // update would rebuild it in the physics engine each time.
+  WorldEdit edit(this);
   _pinLink->GetModel()->SetLinkWorldPose(_pose, _pinLink);
-  if (!_pinJoint)
+  if (_pinJoint)
+    this->ReseatJoint(_pinJoint, math::Vector3(0, 0, 0),
+                      math::Vector3(0, 0, 1));
+  else
     _pinJoint = this->AddJoint(this->world,
                                _pinLink->GetModel(),
                                physics::LinkPtr(),
@@ -908,21 +1670,38 @@ void VRCPlugin::Teleport(const physics::LinkPtr &_pinLink,
                                math::Vector3(0, 0, 0),
                                math::Vector3(0, 0, 1),
                                0.0, 0.0);
-  this->world->SetPaused(p);
-  this->world->EnablePhysicsEngine(e);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Play the trajectory, update states
 void VRCPlugin::UpdateStates()
 {
+  // every world edit of this tick commits in one pause
+  WorldEdit tick(this, true);
+
+  this->ApplyConfig();
+
+  // grab queries of this tick see the current link poses
+  if (this->cheatsEnabled && this->atlas.model)
+    this->UpdateGrabBVH();
+
+  this->ReplayCommands();
+  this->ProcessCommandQueue();
+
   double curTime = this->world->GetSimTime().Double();
-  // if user chooses bdi_stand mode, robot will be initialized
-  // with PID stand in BDI stand pose pinned.
-  // At t-t0 < startupStandPrepDuration seconds, pinned.
-  // At t-t0 = startupStandPrepDuration seconds, begin StandPrep mode.
-  // At t-t0 = startupNominal seconds, unpinned, nominal.
-  // At t-t0 = startupStand seconds, start Stand mode.
+
+  if (this->vehicleRobotJointReleaseTime >= 0 &&
+      curTime >= this->vehicleRobotJointReleaseTime)
+  {
+    this->vehicleRobotJointReleaseTime = -1.0;
+    this->UnweldRobotFromVehicle();
+  }
+
+  if (this->kinematicSubtreesEnabled)
+    this->UpdateKinematicSubtrees();
+
+  // once the robot is spawned, it runs through the startup phases built
+  // by LoadStartupPhases.
   if (this->atlas.startupSequence == Robot::NONE)
   {
     // Load and Spawn Robot
@@ -937,7 +1716,7 @@ void VRCPlugin::UpdateStates()
     else
     {
       // still waiting for robot to be spawned
-      ROS_INFO("waiting for atlas robot to be spawned.");
+      VIGIR_LOG_INFO_THROTTLE(5.0, "waiting for atlas robot to be spawned.");
     }
   }
   else if (this->atlas.startupSequence == Robot::SPAWN_SUCCESS)
@@ -959,9 +1738,17 @@ void VRCPlugin::UpdateStates()
 
     // Note: hardcoded link by name: @todo: make this a pugin param
     this->atlas.initialPose = this->atlas.pinLink->GetWorldPose();
+    this->atlas.footLinks[0] = this->atlas.model->GetLink("l_foot");
+    this->atlas.footLinks[1] = this->atlas.model->GetLink("r_foot");
 
     // initialize atlas command controller
-    this->atlasCommandController.InitModel(this->atlas.model);
+    this->atlasCommandController.InitModel(this->atlas.model,
+                                           &this->rosQueue);
+
+    this->ReserveJoints();
+    this->LoadCollisionProfiles();
+    this->LoadRobotModes();
+    this->LoadKinematicSubtrees();
 
     this->atlas.startupSequence = Robot::INIT_MODEL_SUCCESS;
   }
@@ -976,233 +1763,930 @@ void VRCPlugin::UpdateStates()
     //   Robot PID's to zero joint angles, and pinned to the world.
     //   If StartupHarnessDuration > 0 unpin the robot after duration.
 
-    std::string startInVehicleName = "robot_start_in_vehicle";
-    bool startInVehicle = false;
-    if (this->rosNode->getParam(startInVehicleName, startInVehicle) &&
-                                                            startInVehicle)
+    if (this->robotStartInVehicle)
     {
       gzdbg << "Starting robot in vehicle." << std::endl;
       geometry_msgs::Pose::Ptr poseMsg(new geometry_msgs::Pose());
       this->RobotEnterCar(poseMsg);
       this->atlas.startupSequence = Robot::INITIALIZED;
     }
-    else if (atlas.startupMode == "bdi_stand")
+    else
+    {
+      this->UpdateStartupPhases(curTime);
+    }
+  }
+  else if (this->atlas.startupSequence == Robot::INITIALIZED)
+  {
+    // done, do nothing
+  }
+  else
+  {
+    // should not be here
+  }
+
+  // the stages below work on one read of the world, taken after the
+  // startup stage, which may spawn or move the robot
+  this->ReadFrameState();
+
+  if (this->frame.robotValid)
+    this->propSleep.Update(this->frame.pinPose.pos, curTime);
+
+  if (curTime > this->lastUpdateTime)
+  {
+    this->CheckThreadStart();
+
+    double dt = curTime - this->lastUpdateTime;
+
+    if (this->warpRobotWithCmdVel && this->frame.robotValid &&
+        (this->world->GetSimTime() <= this->warpRobotStopTime))
+    {
+      this->lastUpdateTime = curTime;
+      math::Pose cur_pose = this->frame.pinPose;
+      math::Pose new_pose = cur_pose;
+
+      // increment x,y in cur_pose frame
+      math::Vector3 cmd(this->robotCmdVel.linear.x,
+                        this->robotCmdVel.linear.y, 0);
+      cmd = cur_pose.rot.RotateVector(cmd);
+
+      new_pose.pos = cur_pose.pos + cmd * dt;
+      // prevent robot from drifting vertically
+      new_pose.pos.z = this->atlas.initialPose.pos.z;
+
+      math::Vector3 rpy = cur_pose.rot.GetAsEuler();
+      // decay non-yaw tilts
+      rpy.x = 0;
+      rpy.y = 0;
+      rpy.z = rpy.z + this->robotCmdVel.angular.z * dt;
+
+      new_pose.rot.SetFromEuler(rpy);
+
+      // set this as the new anchor pose of the pin joint
+      this->Teleport(this->atlas.pinLink,
+                     this->atlas.pinJoint,
+                     new_pose);
+      this->frame.pinPose = new_pose;
+    }
+  }
+
+  if ((this->atlas.startupSequence == Robot::INITIALIZED) &&
+      this->cheatsEnabled && this->frame.robotValid)
+  {
+    // publish fake AtlasSimInterfaceState via this->pubFakeASIS, it only
+    // has fixed size arrays and is copied into a pooled message
+    atlas_msgs::AtlasSimInterfaceState asis;
+    asis.error_code = atlas_msgs::AtlasSimInterfaceState::NO_ERRORS;
+    asis.current_behavior = this->atlas.currentBehavior;
+    asis.desired_behavior = this->atlas.currentBehavior;
+    for (size_t i=0; i<asis.f_out.size(); i++)
+      asis.f_out[i] = 0.0;
+    const math::Pose &cur_pose = this->frame.pinPose;
+    asis.pos_est.position.x = cur_pose.pos.x;
+    asis.pos_est.position.y = cur_pose.pos.y;
+    asis.pos_est.position.z = cur_pose.pos.z;
+    const math::Vector3 &cur_vel = this->frame.pinLinearVel;
+    asis.pos_est.velocity.x = cur_vel.x;
+    asis.pos_est.velocity.y = cur_vel.y;
+    asis.pos_est.velocity.z = cur_vel.z;
+    if (!this->frame.footValid[0])
+      VIGIR_LOG_WARN_THROTTLE(5.0,
+        "Couldn't find l_foot link when publishing fake behavior data.");
+    else
+    {
+      const math::Pose &l_foot_pose = this->frame.footPose[0];
+      asis.foot_pos_est[0].position.x = l_foot_pose.pos.x;
+      asis.foot_pos_est[0].position.y = l_foot_pose.pos.y;
+      asis.foot_pos_est[0].position.z = l_foot_pose.pos.z;
+      asis.foot_pos_est[0].orientation.w = l_foot_pose.rot.w;
+      asis.foot_pos_est[0].orientation.x = l_foot_pose.rot.x;
+      asis.foot_pos_est[0].orientation.y = l_foot_pose.rot.y;
+      asis.foot_pos_est[0].orientation.z = l_foot_pose.rot.z;
+    }
+    if (!this->frame.footValid[1])
+      VIGIR_LOG_WARN_THROTTLE(5.0,
+        "Couldn't find r_foot link when publishing fake behavior data.");
+    else
+    {
+      const math::Pose &r_foot_pose = this->frame.footPose[1];
+      asis.foot_pos_est[1].position.x = r_foot_pose.pos.x;
+      asis.foot_pos_est[1].position.y = r_foot_pose.pos.y;
+      asis.foot_pos_est[1].position.z = r_foot_pose.pos.z;
+      asis.foot_pos_est[1].orientation.w = r_foot_pose.rot.w;
+      asis.foot_pos_est[1].orientation.x = r_foot_pose.rot.x;
+      asis.foot_pos_est[1].orientation.y = r_foot_pose.rot.y;
+      asis.foot_pos_est[1].orientation.z = r_foot_pose.rot.z;
+    }
+    for (size_t i=0; i<asis.k_effort.size(); i++)
+      asis.k_effort[i] = 0;
+
+    // Do what we can for the behavior-specific feedback data
+    if (asis.current_behavior == atlas_msgs::AtlasSimInterfaceCommand::WALK)
+    {
+      double time_remaining =
+        (this->warpRobotStopTime - this->world->GetSimTime()).Double();
+      if (time_remaining > 0.0)
+      {
+        // Assuming that t_step_rem should be in milliseconds
+        asis.walk_feedback.t_step_rem = time_remaining * 1e3;
+        asis.walk_feedback.current_step_index = this->atlas.currentStepIndex;
+      }
+      else
+      {
+        asis.walk_feedback.t_step_rem = 0.0;
+        asis.walk_feedback.current_step_index = this->atlas.lastStepIndex;
+      }
+      asis.walk_feedback.next_step_index_needed = this->atlas.lastStepIndex+1;
+      //asis.walk_feedback.status_flags
+      //asis.walk_feedback.step_queue_saturated
+    }
+
+    this->atlas.pubFakeASIS.Publish(asis);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::LoadStartupPhases(const Config &_config)
+{
+  bool fast = (this->atlas.startupProfile == "fast");
+  if (!fast && this->atlas.startupProfile != "default")
+  {
+    ROS_WARN("Unknown atlas startup profile [%s], using default.",
+             this->atlas.startupProfile.c_str());
+  }
+
+  // the default profile reproduces the fixed startup timing, the fast
+  // profile moves on as soon as the joints settled.
+  this->atlas.startupPhases.clear();
+  Robot::StartupPhase phase;
+  if (this->atlas.startupMode == "bdi_stand")
+  {
+    // PID stand in BDI stand pose, pinned
+    phase.name = "pid_stand";
+    phase.action = Robot::SA_PID_STAND;
+    phase.duration = 2.0;
+    phase.minDuration = fast ? 0.2 : 2.0;
+    phase.jointTolerance = fast ? 0.02 : 0.0;
+    this->atlas.startupPhases.push_back(phase);
+
+    // BDI StandPrep, still pinned
+    phase.name = "stand_prep";
+    phase.action = Robot::SA_STAND_PREP;
+    phase.duration = 2.0;
+    phase.minDuration = fast ? 0.5 : 2.0;
+    phase.jointTolerance = fast ? 0.02 : 0.0;
+    this->atlas.startupPhases.push_back(phase);
+
+    // unpinned, nominal
+    phase.name = "nominal";
+    phase.action = Robot::SA_NOMINAL;
+    phase.duration = fast ? 0.01 : 0.1;
+    phase.minDuration = phase.duration;
+    phase.jointTolerance = 0.0;
+    this->atlas.startupPhases.push_back(phase);
+
+    // BDI dynamic stand
+    phase.name = "stand";
+    phase.action = Robot::SA_STAND;
+    phase.duration = 0.0;
+    phase.minDuration = 0.0;
+    phase.jointTolerance = 0.0;
+    this->atlas.startupPhases.push_back(phase);
+  }
+  else
+  {
+    // harnessed with gravity off, stays pinned if time_to_unpin is 0
+    phase.name = "pinned";
+    phase.action = Robot::SA_PINNED;
+    phase.duration = math::equal(this->atlas.startupHarnessDuration, 0.0) ?
+      -1.0 : this->atlas.startupHarnessDuration;
+    phase.minDuration = phase.duration;
+    phase.jointTolerance = 0.0;
+    this->atlas.startupPhases.push_back(phase);
+
+    phase.name = "nominal";
+    phase.action = Robot::SA_NOMINAL;
+    phase.duration = 0.0;
+    phase.minDuration = 0.0;
+    this->atlas.startupPhases.push_back(phase);
+  }
+
+  for (std::vector<Robot::StartupPhase>::iterator it =
+       this->atlas.startupPhases.begin();
+       it != this->atlas.startupPhases.end(); ++it)
+  {
+    for (unsigned int t = 0; t < NumStartupTunables; ++t)
+    {
+      const StartupPhaseTunables &tunables = StartupTunables[t];
+      if (it->name != tunables.name)
+        continue;
+      if (_config.*tunables.duration >= 0)
+        it->duration = _config.*tunables.duration;
+      if (_config.*tunables.minDuration >= 0)
+        it->minDuration = _config.*tunables.minDuration;
+      if (_config.*tunables.jointTolerance >= 0)
+        it->jointTolerance = _config.*tunables.jointTolerance;
+    }
+
+    ROS_INFO("atlas startup phase [%s]: duration %f, min duration %f, "
+             "joint tolerance %f", it->name.c_str(), it->duration,
+             it->minDuration, it->jointTolerance);
+  }
+
+  this->atlas.startupPhase = 0;
+  this->atlas.startupPhaseStartTime = -1.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::BeginStartupPhase(double _curTime)
+{
+  const Robot::StartupPhase &phase =
+    this->atlas.startupPhases[this->atlas.startupPhase];
+  ROS_INFO("atlas startup phase [%s] at t = %f.", phase.name.c_str(),
+           _curTime);
+
+  switch (phase.action)
+  {
+    case Robot::SA_PID_STAND:
+      this->SetRobotMode("pid_stand");
+      break;
+    case Robot::SA_STAND_PREP:
+      this->atlasCommandController.SetBDIStandPrep();
+      break;
+    case Robot::SA_NOMINAL:
+      this->SetRobotMode("nominal");
+      break;
+    case Robot::SA_STAND:
+      this->atlasCommandController.SetBDIStand();
+      break;
+    case Robot::SA_PINNED:
+      this->SetRobotMode("pinned");
+      break;
+  }
+
+  this->atlas.startupPhaseStartTime = _curTime;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::UpdateStartupPhases(double _curTime)
+{
+  if (this->atlas.startupPhase >= this->atlas.startupPhases.size())
+  {
+    this->atlas.startupSequence = Robot::INITIALIZED;
+    return;
+  }
+
+  if (this->atlas.startupPhaseStartTime < 0)
+  {
+    this->BeginStartupPhase(_curTime);
+    return;
+  }
+
+  const Robot::StartupPhase &phase =
+    this->atlas.startupPhases[this->atlas.startupPhase];
+  double elapsed = _curTime - this->atlas.startupPhaseStartTime;
+
+  bool done = phase.duration >= 0 && elapsed > phase.duration;
+  if (!done && phase.jointTolerance > 0 && elapsed >= phase.minDuration)
+    done = this->atlasCommandController.JointsConverged(phase.jointTolerance);
+  if (!done)
+    return;
+
+  ROS_INFO("atlas startup phase [%s] done after %f seconds.",
+           phase.name.c_str(), elapsed);
+
+  ++this->atlas.startupPhase;
+  if (this->atlas.startupPhase < this->atlas.startupPhases.size())
+    this->BeginStartupPhase(_curTime);
+  else
+    this->atlas.startupSequence = Robot::INITIALIZED;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::LoadConfig()
+{
+  // the plugin sdf and the params read before dynamic_reconfigure existed
+  // still seed the tunables, later changes go through vrc_plugin/
+  Config seed = Config::__getDefault__();
+  if (this->sdf->HasElement("grab_max_distance"))
+    seed.grab_max_distance = this->sdf->Get<double>("grab_max_distance");
+  if (this->sdf->HasElement("sleep_radius"))
+    seed.sleep_radius = this->sdf->Get<double>("sleep_radius");
+  if (this->sdf->HasElement("startup_profile"))
+    seed.startup_profile = this->sdf->Get<std::string>("startup_profile");
+
+  if (this->rosNode)
+  {
+    if (!this->rosNode->getParam("cmd_vel_timeout", seed.cmd_vel_timeout))
+    {
+      ROS_INFO("atlas fake walk teleop command timeout param not set, "
+               "defaults to %f seconds.", seed.cmd_vel_timeout);
+    }
+    if (!this->rosNode->getParam("atlas/time_to_unpin", seed.time_to_unpin))
+    {
+      ROS_INFO("atlas/time_to_unpin not specified, default harness duration to"
+               " %f seconds", seed.time_to_unpin);
+    }
+    if (!this->rosNode->getParam("atlas/startup_mode", seed.startup_mode))
+      ROS_INFO("atlas/startup_mode not specified, default pinned.");
+    this->rosNode->getParam("atlas/startup/profile", seed.startup_profile);
+    for (unsigned int t = 0; t < NumStartupTunables; ++t)
+    {
+      const StartupPhaseTunables &tunables = StartupTunables[t];
+      std::string ns = std::string("atlas/startup/") + tunables.name + "/";
+      this->rosNode->getParam(ns + "duration", seed.*tunables.duration);
+      this->rosNode->getParam(ns + "min_duration", seed.*tunables.minDuration);
+      this->rosNode->getParam(ns + "joint_tolerance",
+                              seed.*tunables.jointTolerance);
+    }
+    this->rosNode->getParam("robot_start_in_vehicle",
+                            seed.robot_start_in_vehicle);
+
+    ros::NodeHandle reconfigureNode("vrc_plugin");
+    reconfigureNode.setCallbackQueue(&this->rosQueue);
+    this->reconfigureServer.reset(
+      new dynamic_reconfigure::Server<Config>(reconfigureNode));
+    this->reconfigureServer->updateConfig(seed);
+  }
+
+  boost::atomic_store(&this->config,
+    boost::shared_ptr<const Config>(new Config(seed)));
+
+  // calls OnReconfigure with the seed right away
+  if (this->reconfigureServer)
+  {
+    this->reconfigureServer->setCallback(
+      boost::bind(&VRCPlugin::OnReconfigure, this, _1, _2));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::OnReconfigure(Config &_config, uint32_t /*_level*/)
+{
+  // the physics thread picks the whole set up at its next update
+  boost::atomic_store(&this->config,
+    boost::shared_ptr<const Config>(new Config(_config)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::ApplyConfig()
+{
+  boost::shared_ptr<const Config> latest = boost::atomic_load(&this->config);
+  if (!latest || latest == this->appliedConfig)
+    return;
+
+  this->grabMaxDistance = latest->grab_max_distance;
+  this->robotStartInVehicle = latest->robot_start_in_vehicle;
+  this->propSleep.SetRest(latest->sleep_linear_velocity,
+                          latest->sleep_angular_velocity,
+                          latest->sleep_rest_time);
+  this->propSleep.SetRadius(latest->sleep_radius);
+
+  bool startupChanged = !this->appliedConfig ||
+    this->appliedConfig->startup_mode != latest->startup_mode ||
+    this->appliedConfig->startup_profile != latest->startup_profile ||
+    !math::equal(this->appliedConfig->time_to_unpin, latest->time_to_unpin);
+  for (unsigned int t = 0; !startupChanged && t < NumStartupTunables; ++t)
+  {
+    const StartupPhaseTunables &tunables = StartupTunables[t];
+    const Config &applied = *this->appliedConfig;
+    const Config &next = *latest;
+    startupChanged =
+      !math::equal(applied.*tunables.duration, next.*tunables.duration) ||
+      !math::equal(applied.*tunables.minDuration, next.*tunables.minDuration) ||
+      !math::equal(applied.*tunables.jointTolerance,
+                   next.*tunables.jointTolerance);
+  }
+  this->appliedConfig = latest;
+  if (!startupChanged)
+    return;
+
+  // the startup phases are only rebuilt before the first one began
+  if (this->atlas.startupSequence == Robot::INITIALIZED ||
+      this->atlas.startupPhaseStartTime >= 0)
+  {
+    ROS_WARN("atlas startup settings changed after startup, ignored.");
+    return;
+  }
+
+  this->atlas.startupMode = latest->startup_mode;
+  this->atlas.startupProfile = latest->startup_profile;
+  this->atlas.startupHarnessDuration = latest->time_to_unpin;
+  if (this->atlas.startupMode == "bdi_stand")
+    ROS_INFO("Starting robot with BDI standing");
+  else if (this->atlas.startupMode == "pinned")
+    ROS_INFO("Starting robot pinned");
+  else
+  {
+    ROS_ERROR("Unsupported /atlas/startup_mode [%s]",
+      this->atlas.startupMode.c_str());
+  }
+  this->LoadStartupPhases(*latest);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::ProcessCommandQueue()
+{
+  // every command queued since the last tick was stamped with this one,
+  // commands arriving from now on are stamped with the next.  A stamp past
+  // this tick is only left by a world reset setting the iteration count
+  // back, those are due now as well.
+  uint64_t tick = this->world->GetIterations();
+  std::deque<QueuedCommand> commands;
+  {
+    boost::mutex::scoped_lock lock(this->commandQueueMutex);
+    this->nextCommandTick = tick + 1;
+    commands.swap(this->commandQueue);
+  }
+
+  for (std::deque<QueuedCommand>::iterator it = commands.begin();
+       it != commands.end(); ++it)
+  {
+    it->apply();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::ReplayCommands()
+{
+  if (!this->commandReplay)
+    return;
+
+  uint64_t tick = this->world->GetIterations();
+  CommandRecord rec;
+  while (this->commandReplay->Next(tick, rec))
+  {
+    switch (rec.type)
+    {
+      case CMD_VEL:
+        this->ApplyCommand<geometry_msgs::Twist>(CMD_VEL,
+          &VRCPlugin::SetRobotCmdVelTopic,
+          CommandLogReader::Decode<geometry_msgs::Twist>(rec));
+        break;
+      case CMD_POSE:
+        this->ApplyCommand<geometry_msgs::Pose>(CMD_POSE,
+          &VRCPlugin::SetRobotPose,
+          CommandLogReader::Decode<geometry_msgs::Pose>(rec));
+        break;
+      case CMD_CONFIGURATION:
+        this->ApplyCommand<sensor_msgs::JointState>(CMD_CONFIGURATION,
+          &VRCPlugin::SetRobotConfiguration,
+          CommandLogReader::Decode<sensor_msgs::JointState>(rec));
+        break;
+      case CMD_MODE:
+        this->ApplyCommand<std_msgs::String>(CMD_MODE,
+          &VRCPlugin::SetRobotModeTopic,
+          CommandLogReader::Decode<std_msgs::String>(rec));
+        break;
+      case CMD_FAKE_ASIC:
+        this->ApplyCommand<atlas_msgs::AtlasSimInterfaceCommand>(CMD_FAKE_ASIC,
+          &VRCPlugin::SetFakeASIC,
+          CommandLogReader::Decode<atlas_msgs::AtlasSimInterfaceCommand>(rec));
+        break;
+      case CMD_ENTER_CAR:
+        this->ApplyCommand<geometry_msgs::Pose>(CMD_ENTER_CAR,
+          &VRCPlugin::RobotEnterCar,
+          CommandLogReader::Decode<geometry_msgs::Pose>(rec));
+        break;
+      case CMD_EXIT_CAR:
+        this->ApplyCommand<geometry_msgs::Pose>(CMD_EXIT_CAR,
+          &VRCPlugin::RobotExitCar,
+          CommandLogReader::Decode<geometry_msgs::Pose>(rec));
+        break;
+      case CMD_GRAB:
+        this->ApplyCommand<geometry_msgs::Pose>(CMD_GRAB,
+          &VRCPlugin::RobotGrabFireHose,
+          CommandLogReader::Decode<geometry_msgs::Pose>(rec));
+        break;
+      case CMD_RELEASE:
+        this->ApplyCommand<geometry_msgs::Pose>(CMD_RELEASE,
+          &VRCPlugin::RobotReleaseLink,
+          CommandLogReader::Decode<geometry_msgs::Pose>(rec));
+        break;
+      case CMD_SAVE_SNAPSHOT:
+        this->ApplyCommand<std_msgs::String>(CMD_SAVE_SNAPSHOT,
+          &VRCPlugin::SaveSnapshotTopic,
+          CommandLogReader::Decode<std_msgs::String>(rec));
+        break;
+      case CMD_RESTORE_SNAPSHOT:
+        this->ApplyCommand<std_msgs::String>(CMD_RESTORE_SNAPSHOT,
+          &VRCPlugin::RestoreSnapshotTopic,
+          CommandLogReader::Decode<std_msgs::String>(rec));
+        break;
+      case CMD_GRAB_LINK:
+        this->ApplyCommand<std_msgs::String>(CMD_GRAB_LINK,
+          &VRCPlugin::RobotGrabTopic,
+          CommandLogReader::Decode<std_msgs::String>(rec));
+        break;
+      case CMD_LOAD_LAYOUT:
+        this->ApplyCommand<std_msgs::String>(CMD_LOAD_LAYOUT,
+          &VRCPlugin::LoadLayoutTopic,
+          CommandLogReader::Decode<std_msgs::String>(rec));
+        break;
+      case CMD_SET_LAYOUT:
+        this->ApplyCommand<std_msgs::String>(CMD_SET_LAYOUT,
+          &VRCPlugin::SetLayoutTopic,
+          CommandLogReader::Decode<std_msgs::String>(rec));
+        break;
+      default:
+        gzwarn << "VRCPlugin: unknown command type ["
+               << static_cast<int>(rec.type) << "] in replay log\n";
+    }
+  }
+
+  if (this->commandReplay->Done())
+  {
+    ROS_INFO("VRCPlugin: command replay finished at iteration %lu.",
+             static_cast<unsigned long>(tick));
+    this->commandReplay.reset();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::AddScrewJoint()
+{
+  this->drcFireHose.screwJoint =
+    this->AddJoint(this->world, this->drcFireHose.fireHoseModel,
+                   this->drcFireHose.spoutLink,
+                   this->drcFireHose.couplingLink,
+                   "screw",
+                   math::Vector3(0, 0, 0),
+                   math::Vector3(0, -1, 0),
+                   20, -0.5, false);
+
+  this->drcFireHose.screwJoint->SetParam("thread_pitch", 0,
+    this->drcFireHose.threadPitch);
+
+  // name of the joint
+  // gzerr << this->drcFireHose.screwJoint->GetScopedName() << "\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+VRCPlugin::JointSnapshot VRCPlugin::SaveJoint(const physics::JointPtr &_joint)
+{
+  JointSnapshot snapshot;
+  snapshot.present = static_cast<bool>(_joint);
+  if (_joint)
+  {
+    snapshot.parent = _joint->GetParent();
+    snapshot.child = _joint->GetChild();
+  }
+  return snapshot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::SaveSnapshotTopic(const std_msgs::String::ConstPtr &_name)
+{
+  this->SaveSnapshot(_name->data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::RestoreSnapshotTopic(const std_msgs::String::ConstPtr &_name)
+{
+  this->RestoreSnapshot(_name->data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::LoadLayoutTopic(const std_msgs::String::ConstPtr &_path)
+{
+  std::ifstream file(_path->data.c_str());
+  if (!file)
+  {
+    ROS_WARN("Couldn't open layout file [%s].", _path->data.c_str());
+    return;
+  }
+
+  std::stringstream layout;
+  layout << file.rdbuf();
+  this->ApplyLayout(layout.str());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::SetLayoutTopic(const std_msgs::String::ConstPtr &_layout)
+{
+  this->ApplyLayout(_layout->data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool VRCPlugin::ApplyLayout(const std::string &_layout)
+{
+  // parse and look up everything before touching the world
+  physics::Model_V models;
+  std::vector<math::Pose> poses;
+  bool placeRobot = false;
+  math::Pose robotPose;
+  bool setValve = false;
+  double valveAngle = 0.0;
+
+  std::istringstream lines(_layout);
+  std::string line;
+  for (int lineNumber = 1; std::getline(lines, line); ++lineNumber)
+  {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    std::string key;
+    if (!(fields >> key))
+      continue;
+
+    physics::ModelPtr model;
+    if (key == "valve_angle")
+    {
+      if (!(fields >> valveAngle) || !this->drcFireHose.valveJoint)
+      {
+        ROS_WARN("Layout line %d: bad valve_angle or no valve.", lineNumber);
+        return false;
+      }
+      setValve = true;
+      continue;
+    }
+    else if (key == "vehicle")
+      model = this->drcVehicle.model;
+    else if (key == "fire_hose")
+      model = this->drcFireHose.fireHoseModel;
+    else if (key == "standpipe")
+      model = this->drcFireHose.standpipeModel;
+    else if (key == "valve")
+      model = this->drcFireHose.valveModel;
+    else if (key == "model")
+    {
+      std::string name;
+      if (fields >> name)
+        model = this->world->GetModel(name);
+    }
+    else if (key != "robot")
+    {
+      ROS_WARN("Layout line %d: unknown entry [%s].", lineNumber,
+               key.c_str());
+      return false;
+    }
+
+    double x, y, z, roll, pitch, yaw;
+    if (!(fields >> x >> y >> z >> roll >> pitch >> yaw))
+    {
+      ROS_WARN("Layout line %d: expected a pose.", lineNumber);
+      return false;
+    }
+
+    if (key == "robot")
+    {
+      if (!this->atlas.pinLink)
+      {
+        ROS_WARN("Layout line %d: the robot isn't spawned yet.", lineNumber);
+        return false;
+      }
+      placeRobot = true;
+      robotPose = math::Pose(x, y, z, roll, pitch, yaw);
+    }
+    else if (!model)
+    {
+      ROS_WARN("Layout line %d: model not found.", lineNumber);
+      return false;
+    }
+    else
+    {
+      models.push_back(model);
+      poses.push_back(math::Pose(x, y, z, roll, pitch, yaw));
+    }
+  }
+
+  // turn physics off once for the whole layout
+  WorldEdit edit(this);
+  this->propSleep.WakeAll();
+
+  this->vehicleRobotJointReleaseTime = -1.0;
+  this->UnweldRobotFromVehicle();
+  if (this->grabJoint)
+    this->RemoveJoint(this->grabJoint);
+  this->RemoveJoint(this->handGrabJoints[0]);
+  this->RemoveJoint(this->handGrabJoints[1]);
+  if (this->drcFireHose.screwJoint)
+    this->RemoveJoint(this->drcFireHose.screwJoint);
+
+  for (unsigned int i = 0; i < models.size(); ++i)
+  {
+    models[i]->SetWorldPose(poses[i]);
+    models[i]->ResetPhysicsStates();
+  }
+
+  if (placeRobot)
+  {
+    if (this->atlas.pinJoint)
     {
-      switch (this->atlas.bdiStandSequence)
-      {
-        case Robot::BS_NONE:
-        {
-          // ROS_INFO("BS_NONE");
-          this->SetRobotMode("pid_stand");
-          // start the rest of the sequence
-          this->atlas.bdiStandSequence = Robot::BS_PID_PINNED;
-          this->atlas.startupBDIStandStartTime = this->world->GetSimTime();
-          break;
-        }
-        case Robot::BS_PID_PINNED:
-        {
-          // ROS_INFO("BS_PID_PINNED");
-          if ((curTime - this->atlas.startupBDIStandStartTime.Double()) >
-            atlas.startupStandPrepDuration)
-          {
-            ROS_INFO("going into stand prep");
-            this->atlasCommandController.SetBDIStandPrep();
-            this->atlas.bdiStandSequence = Robot::BS_STAND_PREP_PINNED;
-          }
-          break;
-        }
-        case Robot::BS_STAND_PREP_PINNED:
-        {
-          // ROS_INFO("BS_STAND_PREP_PINNED");
-          if ((curTime - this->atlas.startupBDIStandStartTime.Double()) >
-            atlas.startupNominal)
-          {
-            ROS_INFO("going into Nominal");
-            this->SetRobotMode("nominal");
-            this->atlas.bdiStandSequence = Robot::BS_STAND_PREP;
-          }
-          break;
-        }
-        case Robot::BS_STAND_PREP:
-        {
-          // ROS_INFO("BS_STAND_PREP");
-          if ((curTime - this->atlas.startupBDIStandStartTime.Double()) >
-              atlas.startupStand)
-          {
-            ROS_INFO("going into Dynamic Stand Behavior");
-            this->atlasCommandController.SetBDIStand();
-            this->atlas.bdiStandSequence = Robot::BS_INITIALIZED;
-            this->atlas.startupSequence = Robot::INITIALIZED;
-          }
-          break;
-        }
-      }
+      this->Teleport(this->atlas.pinLink, this->atlas.pinJoint, robotPose);
     }
-    else // if (atlas.startupMode == "pinned")
+    else
     {
-      switch (this->atlas.pinnedSequence)
-      {
-        case Robot::PS_NONE:
-        {
-          ROS_DEBUG("Start robot with gravity turned off and harnessed.");
-          this->SetRobotMode("pinned");
-          if (math::equal(this->atlas.startupHarnessDuration, 0.0))
-          {
-            ROS_INFO("Atlas will stay pinned.");
-            this->atlas.pinnedSequence = Robot::PS_INITIALIZED;
-          }
-          else
-          {
-            ROS_INFO("Resume to nominal mode after %f seconds.",
-              this->atlas.startupHarnessDuration);
-            this->atlas.pinnedSequence = Robot::PS_PINNED;
-          }
-          break;
-        }
-        case Robot::PS_PINNED:
-        {
-          // remove harness
-          if (!math::equal(atlas.startupHarnessDuration, 0.0) &&
-              curTime > atlas.startupHarnessDuration)
-          {
-            this->SetRobotMode("nominal");
-            this->atlas.pinnedSequence = Robot::PS_INITIALIZED;
-            this->atlas.startupSequence = Robot::INITIALIZED;
-          }
-          break;
-        }
-      }
+      this->atlas.model->SetLinkWorldPose(robotPose, this->atlas.pinLink);
     }
+    this->atlas.model->ResetPhysicsStates();
+    this->atlas.initialPose = robotPose;
+    this->warpRobotWithCmdVel = false;
   }
-  else if (this->atlas.startupSequence == Robot::INITIALIZED)
-  {
-    // done, do nothing
-  }
-  else
+
+  if (setValve)
   {
-    // should not be here
+#if GAZEBO_MAJOR_VERSION >= 4
+    this->drcFireHose.valveJoint->SetPosition(0u, valveAngle);
+#else
+    this->drcFireHose.valveJoint->SetAngle(0u, valveAngle);
+#endif
   }
 
-  if (curTime > this->lastUpdateTime)
+  ROS_INFO("Applied layout with %lu models%s at t = %f.",
+           static_cast<unsigned long>(models.size()),
+           placeRobot ? " and the robot" : "",
+           this->world->GetSimTime().Double());
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::SaveSnapshot(const std::string &_name)
+{
+  // any startup phase will do, a robot that stays pinned never finishes
+  // startup
+  if (!this->atlas.model || !this->atlas.pinLink)
   {
-    this->CheckThreadStart();
+    ROS_WARN("Not saving snapshot [%s] before the robot is loaded.",
+             _name.c_str());
+    return;
+  }
 
-    double dt = curTime - this->lastUpdateTime;
+  WorldSnapshot &snapshot = this->snapshots[_name];
+  snapshot = WorldSnapshot();
+
+  physics::ModelPtr models[] = {this->atlas.model,
+                                this->drcVehicle.model,
+                                this->drcFireHose.fireHoseModel,
+                                this->drcFireHose.standpipeModel,
+                                this->drcFireHose.valveModel};
+  for (unsigned int i = 0; i < sizeof(models) / sizeof(models[0]); ++i)
+  {
+    if (!models[i])
+      continue;
+    snapshot.models.push_back(models[i]);
+    snapshot.modelStates.push_back(physics::ModelState(models[i]));
+  }
+
+  physics::Link_V links = this->atlas.model->GetLinks();
+  for (unsigned int i = 0; i < links.size(); ++i)
+    snapshot.atlasGravity.push_back(links[i]->GetGravityMode());
+  snapshot.kinematicSubtrees = this->kinematicSubtreesEnabled;
+
+  snapshot.pinJoint = SaveJoint(this->atlas.pinJoint);
+  snapshot.vehicleRobotJoint = SaveJoint(this->vehicleRobotJoint);
+  snapshot.vehicleWeld = this->vehicleRobotJoint &&
+    this->vehicleRobotJointReleaseTime < 0;
+  snapshot.vehicleReleaseDelay = -1.0;
+  if (this->vehicleRobotJoint && this->vehicleRobotJointReleaseTime >= 0)
+  {
+    snapshot.vehicleReleaseDelay = std::max(0.0,
+      this->vehicleRobotJointReleaseTime -
+      this->world->GetSimTime().Double());
+  }
+  snapshot.grabJoint = SaveJoint(this->grabJoint);
+  snapshot.screwJoint = SaveJoint(this->drcFireHose.screwJoint);
+  snapshot.handGrabJoints[0] = SaveJoint(this->handGrabJoints[0]);
+  snapshot.handGrabJoints[1] = SaveJoint(this->handGrabJoints[1]);
+  snapshot.collisionProfile = this->collisionProfiles.Active();
+  snapshot.atlasInitialPose = this->atlas.initialPose;
+
+  snapshot.warpRobotWithCmdVel = this->warpRobotWithCmdVel;
+  snapshot.warpRobotStopTime = this->warpRobotStopTime;
+  snapshot.robotCmdVel = this->robotCmdVel;
+  snapshot.currentBehavior = this->atlas.currentBehavior;
+  snapshot.currentStepIndex = this->atlas.currentStepIndex;
+  snapshot.lastStepIndex = this->atlas.lastStepIndex;
+  snapshot.atlasCommand = this->atlasCommandController.ac;
+
+  SnapshotRegistry::Instance().Save(snapshot.plugins);
+
+  ROS_INFO("Saved snapshot [%s] at t = %f.", _name.c_str(),
+           this->world->GetSimTime().Double());
+}
 
-    if (this->warpRobotWithCmdVel &&
-        (this->world->GetSimTime() <= this->warpRobotStopTime))
-    {
-      this->lastUpdateTime = curTime;
-      math::Pose cur_pose = this->atlas.pinLink->GetWorldPose();
-      math::Pose new_pose = cur_pose;
+////////////////////////////////////////////////////////////////////////////////
+bool VRCPlugin::RestoreSnapshot(const std::string &_name)
+{
+  std::map<std::string, WorldSnapshot>::const_iterator it =
+    this->snapshots.find(_name);
+  if (it == this->snapshots.end())
+  {
+    ROS_WARN("No snapshot named [%s].", _name.c_str());
+    return false;
+  }
+  const WorldSnapshot &snapshot = it->second;
 
-      // increment x,y in cur_pose frame
-      math::Vector3 cmd(this->robotCmdVel.linear.x,
-                        this->robotCmdVel.linear.y, 0);
-      cmd = cur_pose.rot.RotateVector(cmd);
+  // turn physics off while manipulating things
+  WorldEdit edit(this);
+  this->vehicleRobotJointReleaseTime = -1.0;
+  this->propSleep.WakeAll();
 
-      new_pose.pos = cur_pose.pos + cmd * dt;
-      // prevent robot from drifting vertically
-      new_pose.pos.z = this->atlas.initialPose.pos.z;
+  this->robotMode.clear();
 
-      math::Vector3 rpy = cur_pose.rot.GetAsEuler();
-      // decay non-yaw tilts
-      rpy.x = 0;
-      rpy.y = 0;
-      rpy.z = rpy.z + this->robotCmdVel.angular.z * dt;
+  // drop every dynamic joint, the saved ones are recreated once the
+  // models are back in place
+  if (this->atlas.pinJoint)
+    this->RemoveJoint(this->atlas.pinJoint);
+  this->UnweldRobotFromVehicle();
+  if (this->grabJoint)
+    this->RemoveJoint(this->grabJoint);
+  if (this->drcFireHose.screwJoint)
+    this->RemoveJoint(this->drcFireHose.screwJoint);
+  this->RemoveJoint(this->handGrabJoints[0]);
+  this->RemoveJoint(this->handGrabJoints[1]);
 
-      new_pose.rot.SetFromEuler(rpy);
+  for (unsigned int i = 0; i < snapshot.models.size(); ++i)
+    snapshot.models[i]->SetState(snapshot.modelStates[i]);
 
-      // set this as the new anchor pose of the pin joint
-      this->Teleport(this->atlas.pinLink,
-                     this->atlas.pinJoint,
-                     new_pose);
-    }
+  physics::Link_V links = this->atlas.model->GetLinks();
+  for (unsigned int i = 0; i < links.size() &&
+       i < snapshot.atlasGravity.size(); ++i)
+  {
+    links[i]->SetGravityMode(snapshot.atlasGravity[i]);
   }
+  this->SetKinematicSubtrees(false);
+  this->SetKinematicSubtrees(snapshot.kinematicSubtrees);
 
-  if ((this->atlas.startupSequence == Robot::INITIALIZED) &&
-      this->cheatsEnabled)
+  if (snapshot.pinJoint.present)
   {
-    // publish fake AtlasSimInterfaceState via this->pubFakeASIS
-    atlas_msgs::AtlasSimInterfaceState asis;
-    asis.error_code = atlas_msgs::AtlasSimInterfaceState::NO_ERRORS;
-    asis.current_behavior = this->atlas.currentBehavior;
-    asis.desired_behavior = this->atlas.currentBehavior;
-    for (size_t i=0; i<asis.f_out.size(); i++)
-      asis.f_out[i] = 0.0;
-    math::Pose cur_pose = this->atlas.pinLink->GetWorldPose();
-    asis.pos_est.position.x = cur_pose.pos.x;
-    asis.pos_est.position.y = cur_pose.pos.y;
-    asis.pos_est.position.z = cur_pose.pos.z;
-    math::Vector3 cur_vel = this->atlas.pinLink->GetWorldLinearVel();
-    asis.pos_est.velocity.x = cur_vel.x;
-    asis.pos_est.velocity.y = cur_vel.y;
-    asis.pos_est.velocity.z = cur_vel.z;
-    physics::LinkPtr l_foot_link = this->atlas.model->GetLink("l_foot");
-    if (!l_foot_link)
-      ROS_WARN("Couldn't find l_foot link when publishing fake behavior data.");
-    else
-    {
-      math::Pose l_foot_pose = l_foot_link->GetWorldPose();
-      asis.foot_pos_est[0].position.x = l_foot_pose.pos.x;
-      asis.foot_pos_est[0].position.y = l_foot_pose.pos.y;
-      asis.foot_pos_est[0].position.z = l_foot_pose.pos.z;
-      asis.foot_pos_est[0].orientation.w = l_foot_pose.rot.w;
-      asis.foot_pos_est[0].orientation.x = l_foot_pose.rot.x;
-      asis.foot_pos_est[0].orientation.y = l_foot_pose.rot.y;
-      asis.foot_pos_est[0].orientation.z = l_foot_pose.rot.z;
-    }
-    physics::LinkPtr r_foot_link = this->atlas.model->GetLink("r_foot");
-    if (!l_foot_link)
-      ROS_WARN("Couldn't find l_foot link when publishing fake behavior data.");
-    else
+    this->atlas.pinJoint = this->AddJoint(this->world,
+                                      this->atlas.model,
+                                      physics::LinkPtr(),
+                                      this->atlas.pinLink,
+                                      "revolute",
+                                      math::Vector3(0, 0, 0),
+                                      math::Vector3(0, 0, 1),
+                                      0.0, 0.0);
+  }
+  if (snapshot.vehicleWeld)
+    this->WeldRobotToVehicle();
+  else if (snapshot.vehicleRobotJoint.present)
+  {
+    this->vehicleRobotJoint = this->AddJoint(this->world,
+                                       this->drcVehicle.model,
+                                       this->drcVehicle.seatLink,
+                                       this->atlas.pinLink,
+                                       "revolute",
+                                       math::Vector3(0, 0, 0),
+                                       math::Vector3(0, 0, 1),
+                                       0.0, 0.0);
+
+    // the exit car hold ends after what was left of it
+    if (snapshot.vehicleReleaseDelay >= 0)
     {
-      math::Pose r_foot_pose = r_foot_link->GetWorldPose();
-      asis.foot_pos_est[1].position.x = r_foot_pose.pos.x;
-      asis.foot_pos_est[1].position.y = r_foot_pose.pos.y;
-      asis.foot_pos_est[1].position.z = r_foot_pose.pos.z;
-      asis.foot_pos_est[1].orientation.w = r_foot_pose.rot.w;
-      asis.foot_pos_est[1].orientation.x = r_foot_pose.rot.x;
-      asis.foot_pos_est[1].orientation.y = r_foot_pose.rot.y;
-      asis.foot_pos_est[1].orientation.z = r_foot_pose.rot.z;
+      this->vehicleRobotJointReleaseTime =
+        this->world->GetSimTime().Double() + snapshot.vehicleReleaseDelay;
     }
-    for (size_t i=0; i<asis.k_effort.size(); i++)
-      asis.k_effort[i] = 0;
-
-    // Do what we can for the behavior-specific feedback data
-    if (asis.current_behavior == atlas_msgs::AtlasSimInterfaceCommand::WALK)
+  }
+  if (snapshot.grabJoint.present)
+  {
+    this->grabJoint = this->AddJoint(this->world, this->atlas.model,
+                                     snapshot.grabJoint.parent,
+                                     snapshot.grabJoint.child,
+                                     "revolute",
+                                     math::Vector3(0, 0, 0),
+                                     math::Vector3(0, 0, 1),
+                                     0.0, 0.0);
+  }
+  if (snapshot.screwJoint.present)
+    this->AddScrewJoint();
+  for (unsigned int i = 0; i < 2; ++i)
+  {
+    if (snapshot.handGrabJoints[i].present)
     {
-      double time_remaining =
-        (this->warpRobotStopTime - this->world->GetSimTime()).Double();
-      if (time_remaining > 0.0)
-      {
-        // Assuming that t_step_rem should be in milliseconds
-        asis.walk_feedback.t_step_rem = time_remaining * 1e3;
-        asis.walk_feedback.current_step_index = this->atlas.currentStepIndex;
-      }
-      else
-      {
-        asis.walk_feedback.t_step_rem = 0.0;
-        asis.walk_feedback.current_step_index = this->atlas.lastStepIndex;
-      }
-      asis.walk_feedback.next_step_index_needed = this->atlas.lastStepIndex+1;
-      //asis.walk_feedback.status_flags
-      //asis.walk_feedback.step_queue_saturated
+      this->handGrabJoints[i] = this->AddJoint(this->world, this->atlas.model,
+                                   snapshot.handGrabJoints[i].parent,
+                                   snapshot.handGrabJoints[i].child,
+                                   "revolute",
+                                   math::Vector3(0, 0, 0),
+                                   math::Vector3(0, 0, 1),
+                                   0.0, 0.0);
     }
-
-    this->atlas.pubFakeASIS.publish(asis);
   }
-}
 
-////////////////////////////////////////////////////////////////////////////////
-void VRCPlugin::ROSQueueThread()
-{
-  static const double timeout = 0.01;
+  this->SetCollisionProfile(snapshot.collisionProfile);
+  this->atlas.initialPose = snapshot.atlasInitialPose;
+
+  this->warpRobotWithCmdVel = snapshot.warpRobotWithCmdVel;
+  this->warpRobotStopTime = snapshot.warpRobotStopTime;
+  this->robotCmdVel = snapshot.robotCmdVel;
+  this->atlas.currentBehavior = snapshot.currentBehavior;
+  this->atlas.currentStepIndex = snapshot.currentStepIndex;
+  this->atlas.lastStepIndex = snapshot.lastStepIndex;
 
-  while (this->rosNode->ok())
+  // put the joint controller back on the saved targets
+  this->atlasCommandController.ac = snapshot.atlasCommand;
+  this->atlasCommandController.ac.header.stamp = ros::Time::now();
+  if (this->atlasCommandController.pubAtlasCommand)
   {
-    this->rosQueue.callAvailable(ros::WallDuration(timeout));
+    this->atlasCommandController.pubAtlasCommand.publish(
+      this->atlasCommandController.ac);
   }
+
+  SnapshotRegistry::Instance().Restore(snapshot.plugins);
+
+  ROS_INFO("Restored snapshot [%s] at t = %f.", _name.c_str(),
+           this->world->GetSimTime().Double());
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1232,6 +2716,25 @@ void VRCPlugin::FireHose::Load(physics::WorldPtr _world, sdf::ElementPtr _sdf)
     return;
   }
 
+  // surface of the coupling cylinder is -0.135m from link origin, it
+  // doesn't move relative to the link
+  physics::CollisionPtr attachmentCol =
+    this->couplingLink->GetCollision("attachment_col");
+  physics::CylinderShapePtr attachmentShape;
+  if (attachmentCol)
+  {
+    attachmentShape = boost::dynamic_pointer_cast<physics::CylinderShape>(
+      attachmentCol->GetShape());
+  }
+  if (!attachmentShape)
+  {
+    ROS_ERROR("VRCPlugin: coupling link [%s] has no cylinder collision "
+      "[attachment_col], threading disabled.", couplingLinkName.c_str());
+    return;
+  }
+  this->couplingSurfaceOffset = attachmentCol->GetRelativePose().pos.x -
+    attachmentShape->GetLength() / 2;
+
   // Get joints
   this->fireHoseJoints = this->fireHoseModel->GetJoints();
 
@@ -1311,27 +2814,53 @@ void VRCPlugin::FireHose::SetInitialConfiguration()
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::ReadFrameState()
+{
+  FrameState &frame = this->frame;
+
+  frame.robotValid = static_cast<bool>(this->atlas.pinLink);
+  if (frame.robotValid)
+  {
+    frame.pinPose = this->atlas.pinLink->GetWorldPose();
+    frame.pinLinearVel = this->atlas.pinLink->GetWorldLinearVel();
+  }
+  for (int i = 0; i < 2; ++i)
+  {
+    frame.footValid[i] = static_cast<bool>(this->atlas.footLinks[i]);
+    if (frame.footValid[i])
+      frame.footPose[i] = this->atlas.footLinks[i]->GetWorldPose();
+  }
+
+  frame.hoseValid = this->drcFireHose.isInitialized;
+  frame.valveAngle = 0.0;
+  frame.screwAngle = 0.0;
+  if (frame.hoseValid)
+  {
+    frame.couplingPose = this->drcFireHose.couplingLink->GetWorldPose();
+    frame.spoutPose = this->drcFireHose.spoutLink->GetWorldPose();
+    if (this->drcFireHose.valveJoint)
+      frame.valveAngle = this->drcFireHose.valveJoint->GetAngle(0).Radian();
+    if (this->drcFireHose.screwJoint)
+      frame.screwAngle = this->drcFireHose.screwJoint->GetAngle(0).Radian();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
 void VRCPlugin::CheckThreadStart()
 {
-  if (!this->drcFireHose.isInitialized)
+  if (!this->frame.hoseValid)
     return;
 
   // gzerr << "coupling [" << this->couplingLink->GetWorldPose() << "]\n";
   // gzerr << "spout [" << this->spoutLink->GetWorldPose() << "]\n"
   math::Pose connectPose(this->drcFireHose.couplingRelativePose);
 
-  // surface of the coupling cylinder is -0.135m from link origin
-  physics::CollisionPtr col =
-    this->drcFireHose.couplingLink->GetCollision("attachment_col");
-  double collisionSurfaceZOffset =
-    col->GetRelativePose().pos.x -
-    boost::dynamic_pointer_cast<physics::CylinderShape>(
-    col->GetShape())->GetLength()/2;
+  double collisionSurfaceZOffset = this->drcFireHose.couplingSurfaceOffset;
 
   math::Pose relativePose =
     (math::Pose(collisionSurfaceZOffset, 0, 0, 0, 0, 0) +
-     this->drcFireHose.couplingLink->GetWorldPose()) -
-    this->drcFireHose.spoutLink->GetWorldPose();
+     this->frame.couplingPose) - this->frame.spoutPose;
 
   double posErrInsert = relativePose.pos.z - connectPose.pos.z +
     collisionSurfaceZOffset;
@@ -1339,9 +2868,7 @@ void VRCPlugin::CheckThreadStart()
                         fabs(relativePose.pos.y - connectPose.pos.y);
   double rotErr = (relativePose.rot.GetXAxis() -
                    connectPose.rot.GetXAxis()).GetLength();
-  double valveAng = 0;
-  if (this->drcFireHose.valveJoint)
-    valveAng = this->drcFireHose.valveJoint->GetAngle(0).Radian();
+  double valveAng = this->frame.valveAngle;
 
   /* uncomment for debugging
   gzdbg << " connectPose [" << connectPose
@@ -1372,26 +2899,13 @@ void VRCPlugin::CheckThreadStart()
     if (posErrInsert > 0.0 && posErrCenter < 0.003 &&
         rotErr < 0.05 && valveAng > -0.1)
     {
-      this->drcFireHose.screwJoint =
-        this->AddJoint(this->world, this->drcFireHose.fireHoseModel,
-                       this->drcFireHose.spoutLink,
-                       this->drcFireHose.couplingLink,
-                       "screw",
-                       math::Vector3(0, 0, 0),
-                       math::Vector3(0, -1, 0),
-                       20, -0.5, false);
-
-      this->drcFireHose.screwJoint->SetParam("thread_pitch", 0,
-        this->drcFireHose.threadPitch);
-
-      // name of the joint
-      // gzerr << this->drcFireHose.screwJoint->GetScopedName() << "\n";
+      this->AddScrewJoint();
     }
   }
   else
   {
     // check joint position to disconnect
-    double position = this->drcFireHose.screwJoint->GetAngle(0).Radian();
+    double position = this->frame.screwAngle;
     // gzdbg << "unscrew if [" <<  position << "] < -0.003\n";
     if (position < -0.0003)
       this->RemoveJoint(this->drcFireHose.screwJoint);
@@ -1403,6 +2917,23 @@ void VRCPlugin::CheckThreadStart()
 void VRCPlugin::Vehicle::Load(physics::WorldPtr _world, sdf::ElementPtr _sdf)
 {
   this->isInitialized = false;
+  this->weldRobot = false;
+  this->disableCabCollision = false;
+  this->freezeLegs = false;
+  if (_sdf->HasElement("drc_vehicle"))
+  {
+    sdf::ElementPtr vehicleSDF = _sdf->GetElement("drc_vehicle");
+    if (vehicleSDF->HasElement("weld_robot"))
+      this->weldRobot = vehicleSDF->Get<bool>("weld_robot");
+    if (vehicleSDF->HasElement("disable_cab_collision"))
+    {
+      this->disableCabCollision =
+        vehicleSDF->Get<bool>("disable_cab_collision");
+    }
+    if (vehicleSDF->HasElement("freeze_legs"))
+      this->freezeLegs = vehicleSDF->Get<bool>("freeze_legs");
+  }
+
   // load parameters
   if (_sdf->HasElement("drc_vehicle") &&
       _sdf->GetElement("drc_vehicle")->HasElement("model_name"))
@@ -1450,15 +2981,12 @@ VRCPlugin::Robot::Robot()
  : currentBehavior(-1)
 {
   this->startupSequence = Robot::NONE;
-  this->bdiStandSequence = Robot::BS_NONE;
-  this->pinnedSequence = Robot::PS_NONE;
+  this->startupPhase = 0;
+  this->startupPhaseStartTime = -1.0;
+  this->startupProfile = "default";
 
   // bunch of hardcoded presets
   this->startupHarnessDuration = 5;
-  this->startupStandPrepDuration = 2.0;
-  this->startupNominal = this->startupStandPrepDuration + 2.0;
-  this->startupStand = this->startupNominal + 0.1;
-
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1508,6 +3036,13 @@ void VRCPlugin::Robot::InsertModel(physics::WorldPtr _world,
   }
   else
   {
+    if (!ros::isInitialized())
+    {
+      VIGIR_LOG_ERROR_THROTTLE(5.0, "atlas model not in world file, and no "
+                               "ROS parameter server to spawn it from.");
+      return;
+    }
+
     ROS_INFO("atlas model not in world file, spawning from ros param [%s].",
       robotDescriptionName.c_str());
 
@@ -1528,17 +3063,20 @@ void VRCPlugin::Robot::InsertModel(physics::WorldPtr _world,
     else
       ROS_ERROR("robot initial spawn pose not found");
 
-    std::string robotStr;
-    if (rh.getParam(robotDescriptionName, robotStr))
+    std::string robotStr, robotSDF;
+    if (rh.getParam(robotDescriptionName, robotStr) &&
+        ModelCache::ToSDF(robotStr, robotSDF))
     {
-      // put model into gazebo factory queue (non-blocking)
-      _world->InsertModelString(robotStr);
+      // put model into gazebo factory queue (non-blocking), as SDF so the
+      // URDF is only converted the first time it's spawned
+      _world->InsertModelString(robotSDF);
       this->startupSequence = Robot::SPAWN_QUEUED;
       ROS_INFO("atlas model pushed into gazebo spawn queue.");
     }
     else
     {
-      ROS_ERROR("failed to spawn model from rosparam: [%s].",
+      VIGIR_LOG_ERROR_THROTTLE(5.0,
+        "failed to spawn model from rosparam: [%s].",
         robotDescriptionName.c_str());
       this->startupSequence = Robot::NONE;
     }
@@ -1567,12 +3105,14 @@ void VRCPlugin::LoadVRCROSAPI()
 {
   if (this->cheatsEnabled)
   {
-    // ros subscription
+    // ros subscription, commands that edit the world apply at a tick
+    // boundary
     std::string robot_enter_car_topic_name = "drc_world/robot_enter_car";
     ros::SubscribeOptions robot_enter_car_so =
       ros::SubscribeOptions::create<geometry_msgs::Pose>(
       robot_enter_car_topic_name, 100,
-      boost::bind(&VRCPlugin::RobotEnterCar, this, _1),
+      boost::bind(&VRCPlugin::OnCommand<geometry_msgs::Pose>, this,
+                  CMD_ENTER_CAR, &VRCPlugin::RobotEnterCar, _1),
       ros::VoidPtr(), &this->rosQueue);
     this->subRobotEnterCar = this->rosNode->subscribe(robot_enter_car_so);
 
@@ -1580,7 +3120,8 @@ void VRCPlugin::LoadVRCROSAPI()
     ros::SubscribeOptions robot_exit_car_so =
       ros::SubscribeOptions::create<geometry_msgs::Pose>(
       robot_exit_car_topic_name, 100,
-      boost::bind(&VRCPlugin::RobotExitCar, this, _1),
+      boost::bind(&VRCPlugin::OnCommand<geometry_msgs::Pose>, this,
+                  CMD_EXIT_CAR, &VRCPlugin::RobotExitCar, _1),
       ros::VoidPtr(), &this->rosQueue);
     this->subRobotExitCar = this->rosNode->subscribe(robot_exit_car_so);
 
@@ -1588,7 +3129,8 @@ void VRCPlugin::LoadVRCROSAPI()
     ros::SubscribeOptions robot_grab_so =
       ros::SubscribeOptions::create<geometry_msgs::Pose>(
       robot_grab_topic_name, 100,
-      boost::bind(&VRCPlugin::RobotGrabFireHose, this, _1),
+      boost::bind(&VRCPlugin::OnCommand<geometry_msgs::Pose>, this,
+                  CMD_GRAB, &VRCPlugin::RobotGrabFireHose, _1),
       ros::VoidPtr(), &this->rosQueue);
     this->subRobotGrab = this->rosNode->subscribe(robot_grab_so);
 
@@ -1596,41 +3138,64 @@ void VRCPlugin::LoadVRCROSAPI()
     ros::SubscribeOptions robot_release_so =
       ros::SubscribeOptions::create<geometry_msgs::Pose>(
       robot_release_topic_name, 100,
-      boost::bind(&VRCPlugin::RobotReleaseLink, this, _1),
+      boost::bind(&VRCPlugin::OnCommand<geometry_msgs::Pose>, this,
+                  CMD_RELEASE, &VRCPlugin::RobotReleaseLink, _1),
       ros::VoidPtr(), &this->rosQueue);
     this->subRobotRelease = this->rosNode->subscribe(robot_release_so);
+
+    // "<left|right> [<model>[::<link>]]", nearest link if no target
+    std::string robot_grab_link_topic_name = "drc_world/robot_grab";
+    ros::SubscribeOptions robot_grab_link_so =
+      ros::SubscribeOptions::create<std_msgs::String>(
+      robot_grab_link_topic_name, 100,
+      boost::bind(&VRCPlugin::OnCommand<std_msgs::String>, this,
+                  CMD_GRAB_LINK, &VRCPlugin::RobotGrabTopic, _1),
+      ros::VoidPtr(), &this->rosQueue);
+    this->subRobotGrabLink = this->rosNode->subscribe(robot_grab_link_so);
+
+    // snapshots always apply at a tick boundary
+    std::string save_snapshot_topic_name = "drc_world/save_snapshot";
+    ros::SubscribeOptions save_snapshot_so =
+      ros::SubscribeOptions::create<std_msgs::String>(
+      save_snapshot_topic_name, 100,
+      boost::bind(&VRCPlugin::OnCommand<std_msgs::String>, this,
+                  CMD_SAVE_SNAPSHOT, &VRCPlugin::SaveSnapshotTopic, _1),
+      ros::VoidPtr(), &this->rosQueue);
+    this->subSaveSnapshot = this->rosNode->subscribe(save_snapshot_so);
+
+    std::string restore_snapshot_topic_name = "drc_world/restore_snapshot";
+    ros::SubscribeOptions restore_snapshot_so =
+      ros::SubscribeOptions::create<std_msgs::String>(
+      restore_snapshot_topic_name, 100,
+      boost::bind(&VRCPlugin::OnCommand<std_msgs::String>, this,
+                  CMD_RESTORE_SNAPSHOT, &VRCPlugin::RestoreSnapshotTopic, _1),
+      ros::VoidPtr(), &this->rosQueue);
+    this->subRestoreSnapshot = this->rosNode->subscribe(restore_snapshot_so);
+
+    // scenario layouts, from a file or inline
+    std::string load_layout_topic_name = "drc_world/load_layout";
+    ros::SubscribeOptions load_layout_so =
+      ros::SubscribeOptions::create<std_msgs::String>(
+      load_layout_topic_name, 100,
+      boost::bind(&VRCPlugin::OnCommand<std_msgs::String>, this,
+                  CMD_LOAD_LAYOUT, &VRCPlugin::LoadLayoutTopic, _1),
+      ros::VoidPtr(), &this->rosQueue);
+    this->subLoadLayout = this->rosNode->subscribe(load_layout_so);
+
+    std::string set_layout_topic_name = "drc_world/set_layout";
+    ros::SubscribeOptions set_layout_so =
+      ros::SubscribeOptions::create<std_msgs::String>(
+      set_layout_topic_name, 100,
+      boost::bind(&VRCPlugin::OnCommand<std_msgs::String>, this,
+                  CMD_SET_LAYOUT, &VRCPlugin::SetLayoutTopic, _1),
+      ros::VoidPtr(), &this->rosQueue);
+    this->subSetLayout = this->rosNode->subscribe(set_layout_so);
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void VRCPlugin::LoadRobotROSAPI()
 {
-  if (!this->rosNode->getParam("atlas/time_to_unpin",
-    atlas.startupHarnessDuration))
-  {
-    ROS_INFO("atlas/time_to_unpin not specified, default harness duration to"
-             " %f seconds", atlas.startupHarnessDuration);
-  }
-
-  if (!this->rosNode->getParam("atlas/startup_mode", atlas.startupMode))
-  {
-    ROS_INFO("atlas/startup_mode not specified, default bdi_stand that "
-             " takes %f seconds to finish.", atlas.startupStandPrepDuration);
-  }
-  else if (atlas.startupMode == "bdi_stand")
-  {
-    ROS_INFO("Starting robot with BDI standing");
-  }
-  else if (atlas.startupMode == "pinned")
-  {
-    ROS_INFO("Starting robot pinned");
-  }
-  else
-  {
-    ROS_ERROR("Unsupported /atlas/startup_mode [%s]",
-      atlas.startupMode.c_str());
-  }
-
   if (this->cheatsEnabled)
   {
     // ros subscription
@@ -1638,7 +3203,8 @@ void VRCPlugin::LoadRobotROSAPI()
     ros::SubscribeOptions trajectory_so =
       ros::SubscribeOptions::create<geometry_msgs::Twist>(
       trajectory_topic_name, 100,
-      boost::bind(&VRCPlugin::SetRobotCmdVelTopic, this, _1),
+      boost::bind(&VRCPlugin::OnCommand<geometry_msgs::Twist>, this,
+                  CMD_VEL, &VRCPlugin::SetRobotCmdVelTopic, _1),
       ros::VoidPtr(), &this->rosQueue);
     this->atlas.subTrajectory = this->rosNode->subscribe(trajectory_so);
 
@@ -1646,7 +3212,8 @@ void VRCPlugin::LoadRobotROSAPI()
     ros::SubscribeOptions pose_so =
       ros::SubscribeOptions::create<geometry_msgs::Pose>(
       pose_topic_name, 100,
-      boost::bind(&VRCPlugin::SetRobotPose, this, _1),
+      boost::bind(&VRCPlugin::OnCommand<geometry_msgs::Pose>, this,
+                  CMD_POSE, &VRCPlugin::SetRobotPose, _1),
       ros::VoidPtr(), &this->rosQueue);
     this->atlas.subPose = this->rosNode->subscribe(pose_so);
 
@@ -1654,7 +3221,8 @@ void VRCPlugin::LoadRobotROSAPI()
     ros::SubscribeOptions configuration_so =
       ros::SubscribeOptions::create<sensor_msgs::JointState>(
       configuration_topic_name, 100,
-      boost::bind(&VRCPlugin::SetRobotConfiguration, this, _1),
+      boost::bind(&VRCPlugin::OnCommand<sensor_msgs::JointState>, this,
+                  CMD_CONFIGURATION, &VRCPlugin::SetRobotConfiguration, _1),
       ros::VoidPtr(), &this->rosQueue);
     this->atlas.subConfiguration =
       this->rosNode->subscribe(configuration_so);
@@ -1663,7 +3231,8 @@ void VRCPlugin::LoadRobotROSAPI()
     ros::SubscribeOptions mode_so =
       ros::SubscribeOptions::create<std_msgs::String>(
       mode_topic_name, 100,
-      boost::bind(&VRCPlugin::SetRobotModeTopic, this, _1),
+      boost::bind(&VRCPlugin::OnCommand<std_msgs::String>, this,
+                  CMD_MODE, &VRCPlugin::SetRobotModeTopic, _1),
       ros::VoidPtr(), &this->rosQueue);
     this->atlas.subMode = this->rosNode->subscribe(mode_so);
 
@@ -1671,14 +3240,16 @@ void VRCPlugin::LoadRobotROSAPI()
     ros::SubscribeOptions fake_asic_so =
       ros::SubscribeOptions::create<atlas_msgs::AtlasSimInterfaceCommand>(
       fake_asic_topic_name, 100,
-      boost::bind(&VRCPlugin::SetFakeASIC, this, _1),
+      boost::bind(
+        &VRCPlugin::OnCommand<atlas_msgs::AtlasSimInterfaceCommand>, this,
+        CMD_FAKE_ASIC, &VRCPlugin::SetFakeASIC, _1),
       ros::VoidPtr(), &this->rosQueue);
     this->atlas.subFakeASIC = this->rosNode->subscribe(fake_asic_so);
 
     // ros advertisement
-    this->atlas.pubFakeASIS =
+    this->atlas.pubFakeASIS.Init(
       this->rosNode->advertise<atlas_msgs::AtlasSimInterfaceState>(
-      "atlas/fake/atlas_sim_interface_state", 1, true);
+      "atlas/fake/atlas_sim_interface_state", 1, true));
   }
 }
 
@@ -1721,38 +3292,42 @@ std::string VRCPlugin::AtlasCommandController::FindJoint(
 
 ////////////////////////////////////////////////////////////////////////////////
 VRCPlugin::AtlasCommandController::AtlasCommandController()
- : js_valid(false)
+ : rosNode(NULL), js_valid(false)
 {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void VRCPlugin::AtlasCommandController::InitModel(physics::ModelPtr _model)
+void VRCPlugin::AtlasCommandController::InitModel(physics::ModelPtr _model,
+                                                  ros::CallbackQueue *_queue)
 {
-  // initialize ros
-  if (!ros::isInitialized())
-  {
-    gzerr << "Not loading AtlasCommandController since ROS hasn't been "
-          << "properly initialized.  Try starting Gazebo with"
-          << " ros plugin:\n"
-          << "  gazebo -s libgazebo_ros_api_plugin.so\n";
-    return;
-  }
-
   this->model = _model;
 
-  // ros stuff
-  this->rosNode = new ros::NodeHandle("");
+  // Without ROS (headless command replay) the joint tables are still set up
+  // from defaults, only the ROS interface is left out.
+  if (ros::isInitialized())
+  {
+    // ros stuff, on the VRCPlugin callback queue
+    this->rosNode = new ros::NodeHandle("");
+    this->rosNode->setCallbackQueue(_queue);
+  }
+  else
+  {
+    gzwarn << "AtlasCommandController: ROS hasn't been initialized, "
+           << "atlas commands won't be published.\n";
+  }
 
   // Get atlas version, and set joint count
   this->atlasVersion = 5;
-  if (!this->rosNode->getParam("atlas_version", this->atlasVersion))
+  if (!this->rosNode ||
+      !this->rosNode->getParam("atlas_version", this->atlasVersion))
   {
     ROS_WARN("atlas_version not set, assuming version 5");
   }
 
   // Read the subversion of Atlas. The parameter is optional
   this->atlasSubVersion = 0;
-  this->rosNode->getParam("atlas_sub_version", this->atlasSubVersion);
+  if (this->rosNode)
+    this->rosNode->getParam("atlas_sub_version", this->atlasSubVersion);
 
   // must match those inside AtlasPlugin
   this->jointNames.push_back(this->FindJoint("back_bkz",  "back_lbz"));
@@ -1801,6 +3376,10 @@ void VRCPlugin::AtlasCommandController::InitModel(physics::ModelPtr _model)
   }
 
   unsigned int n = this->jointNames.size();
+  this->joints.clear();
+  for (unsigned int i = 0; i < n; ++i)
+    this->joints.push_back(_model->GetJoint(this->jointNames[i]));
+
   this->ac.position.resize(n);
   this->ac.velocity.resize(n);
   this->ac.effort.resize(n);
@@ -1814,29 +3393,16 @@ void VRCPlugin::AtlasCommandController::InitModel(physics::ModelPtr _model)
 
   for (unsigned int i = 0; i < n; ++i)
   {
-    double val;
-    this->rosNode->getParam("atlas_controller/gains/" + this->jointNames[i] +
-      "/p", val);
-    this->ac.kp_position[i] = val;
-
-    this->rosNode->getParam("atlas_controller/gains/" + this->jointNames[i] +
-      "/i", val);
-    this->ac.ki_position[i] = val;
-
-    this->rosNode->getParam("atlas_controller/gains/" + this->jointNames[i] +
-      "/d", val);
-    this->ac.kd_position[i] = val;
-
-    this->rosNode->getParam("atlas_controller/gains/" + this->jointNames[i] +
-      "/i_clamp", val);
-    this->ac.i_effort_min[i] = -val;
-    this->ac.i_effort_max[i] = val;
     this->ac.k_effort[i] =  255;
 
     this->ac.velocity[i]     = 0;
     this->ac.effort[i]       = 0;
     this->ac.kp_velocity[i]  = 0;
   }
+  this->LoadGains("atlas_controller/gains");
+
+  if (!this->rosNode)
+    return;
 
   this->pubAtlasCommand =
     this->rosNode->advertise<atlas_msgs::AtlasCommand>(
@@ -1852,24 +3418,98 @@ void VRCPlugin::AtlasCommandController::InitModel(physics::ModelPtr _model)
     boost::bind(&AtlasCommandController::GetJointStates, this, _1),
     ros::VoidPtr(), this->rosNode->getCallbackQueue());
   this->subJointStates = this->rosNode->subscribe(jointStatesSo);
+
+  ros::SubscribeOptions atlasCommandSo =
+    ros::SubscribeOptions::create<atlas_msgs::AtlasCommand>(
+    "atlas/atlas_command", 1,
+    boost::bind(&AtlasCommandController::GetAtlasCommand, this, _1),
+    ros::VoidPtr(), this->rosNode->getCallbackQueue());
+  this->subAtlasCommand = this->rosNode->subscribe(atlasCommandSo);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::AtlasCommandController::LoadGains(const std::string &_ns)
+{
+  if (!this->rosNode)
+    return;
+
+  // gains without a param keep their value
+  for (unsigned int i = 0; i < this->jointNames.size(); ++i)
+  {
+    std::string ns = _ns + "/" + this->jointNames[i] + "/";
+    double val;
+    if (this->rosNode->getParam(ns + "p", val))
+      this->ac.kp_position[i] = val;
+    if (this->rosNode->getParam(ns + "i", val))
+      this->ac.ki_position[i] = val;
+    if (this->rosNode->getParam(ns + "d", val))
+      this->ac.kd_position[i] = val;
+    if (this->rosNode->getParam(ns + "i_clamp", val))
+    {
+      this->ac.i_effort_min[i] = -val;
+      this->ac.i_effort_max[i] = val;
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 VRCPlugin::AtlasCommandController::~AtlasCommandController()
 {
-  this->rosNode->shutdown();
+  if (this->rosNode)
+    this->rosNode->shutdown();
   delete this->rosNode;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool VRCPlugin::AtlasCommandController::JointsConverged(
+  double _tolerance) const
+{
+  for (unsigned int i = 0; i < this->joints.size(); ++i)
+  {
+    if (this->joints[i] && i < this->ac.position.size() &&
+        fabs(this->joints[i]->GetAngle(0).Radian() - this->ac.position[i]) >
+        _tolerance)
+      return false;
+  }
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void VRCPlugin::AtlasCommandController::GetJointStates(
         const sensor_msgs::JointState::ConstPtr &_js)
 {
   /// \todo: implement joint state monitoring when setting configuration
+  boost::mutex::scoped_lock lock(this->jsMutex);
   this->js = _js;
   this->js_valid = true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void VRCPlugin::AtlasCommandController::GetAtlasCommand(
+        const atlas_msgs::AtlasCommand::ConstPtr &_ac)
+{
+  boost::mutex::scoped_lock lock(this->lastCommandMutex);
+  this->lastCommand = _ac;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+atlas_msgs::AtlasCommand::ConstPtr
+  VRCPlugin::AtlasCommandController::GetLastCommand()
+{
+  boost::mutex::scoped_lock lock(this->lastCommandMutex);
+  return this->lastCommand;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+sensor_msgs::JointState::ConstPtr
+  VRCPlugin::AtlasCommandController::GetLastJointStates()
+{
+  boost::mutex::scoped_lock lock(this->jsMutex);
+  if (!this->js_valid)
+    return sensor_msgs::JointState::ConstPtr();
+  return this->js;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void VRCPlugin::AtlasCommandController::SetPIDStand(
   physics::ModelPtr atlasModel)
@@ -1987,7 +3627,8 @@ void VRCPlugin::AtlasCommandController::SetPIDStand(
   atlasModel->SetJointPositions(jps);
 
   // publish AtlasCommand
-  this->pubAtlasCommand.publish(ac);
+  if (this->pubAtlasCommand)
+    this->pubAtlasCommand.publish(ac);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1996,7 +3637,8 @@ void VRCPlugin::AtlasCommandController::SetBDIFREEZE()
   atlas_msgs::AtlasSimInterfaceCommand ac;
   ac.header.stamp = ros::Time::now();
   ac.behavior = ac.FREEZE;
-  this->pubAtlasSimInterfaceCommand.publish(ac);
+  if (this->pubAtlasSimInterfaceCommand)
+    this->pubAtlasSimInterfaceCommand.publish(ac);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2008,7 +3650,8 @@ void VRCPlugin::AtlasCommandController::SetBDIStandPrep()
   ac.k_effort.resize(this->jointNames.size());
   for (unsigned int i = 0; i < this->jointNames.size(); ++i)
     this->ac.k_effort[i] = 0;
-  this->pubAtlasSimInterfaceCommand.publish(ac);
+  if (this->pubAtlasSimInterfaceCommand)
+    this->pubAtlasSimInterfaceCommand.publish(ac);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2020,7 +3663,8 @@ void VRCPlugin::AtlasCommandController::SetBDIStand()
     ac.k_effort[i] =  0;
   ac.header.stamp = ros::Time::now();
   ac.behavior = ac.STAND;
-  this->pubAtlasSimInterfaceCommand.publish(ac);
+  if (this->pubAtlasSimInterfaceCommand)
+    this->pubAtlasSimInterfaceCommand.publish(ac);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2084,7 +3728,8 @@ void VRCPlugin::AtlasCommandController::SetSeatingConfiguration(
   atlasModel->SetJointPositions(jps);
 
   // publish AtlasCommand
-  this->pubAtlasCommand.publish(ac);
+  if (this->pubAtlasCommand)
+    this->pubAtlasCommand.publish(ac);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2148,6 +3793,7 @@ void VRCPlugin::AtlasCommandController::SetStandingConfiguration(
   atlasModel->SetJointPositions(jps);
 
   // publish AtlasCommand
-  this->pubAtlasCommand.publish(ac);
+  if (this->pubAtlasCommand)
+    this->pubAtlasCommand.publish(ac);
 }
 }